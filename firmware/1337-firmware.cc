@@ -18,12 +18,28 @@ template<class T, class U = T>
 
 // Local:
 #include "mcu.h"
+#include "system_clock.h"
+#include "buzzer.h"
+#include "latency_histogram.h"
+#include "edge_beeper.h"
+#include "scheduler.h"
+#include "bcd.h"
+#include "fixed_point.h"
 #include "time.h"
-#include "loop_calibrator.h"
+#include "countdown.h"
 #include "rtc.h"
-#include "debouncer.h"
-#include "switch.h"
+#include "rtc_transaction.h"
+#include "time_keeper.h"
+#include "spsc_queue.h"
+#include "gesture_recognizer.h"
+#include "button_capture.h"
+#include "port_debouncer.h"
+#include "font.h"
+#include "marquee.h"
+#include "display_content.h"
 #include "display.h"
+#include "shift_register_display.h"
+#include "ui_table.h"
 #include "clock.h"
 
 
@@ -0,0 +1,164 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__BCD__INCLUDED
+#define CLOCK_1337__BCD__INCLUDED
+
+/**
+ * Packed-BCD helpers. A byte holds two decimal digits, tens in the high nibble.
+ * All functions work on nibbles only, so they don't need division.
+ */
+namespace bcd {
+
+/**
+ * Return tens digit.
+ */
+constexpr uint8_t
+tens (uint8_t value)
+{
+	return value >> 4;
+}
+
+
+/**
+ * Return ones digit.
+ */
+constexpr uint8_t
+ones (uint8_t value)
+{
+	return value & 0b1111;
+}
+
+
+/**
+ * Make packed-BCD value from two digits.
+ */
+constexpr uint8_t
+make (uint8_t tens, uint8_t ones)
+{
+	return static_cast<uint8_t> (tens << 4) | ones;
+}
+
+
+/**
+ * Return true if value is a valid BCD number not greater than max (given in BCD).
+ */
+constexpr bool
+valid (uint8_t value, uint8_t max)
+{
+	return value <= max && ones (value) <= 9;
+}
+
+
+/**
+ * Convert to binary. Uses multiplication only.
+ */
+constexpr uint8_t
+to_binary (uint8_t value)
+{
+	return tens (value) * 10 + ones (value);
+}
+
+
+/**
+ * Convert binary value 0…99 to BCD. Uses division, so it's meant
+ * for constants and rare conversions only.
+ */
+constexpr uint8_t
+from_binary (uint8_t value)
+{
+	return make (value / 10, value % 10);
+}
+
+
+/**
+ * Increment value, wrapping to 0 after max (given in BCD).
+ * Return true if it wrapped.
+ */
+constexpr bool
+increment (uint8_t& value, uint8_t max)
+{
+	if (value == max)
+	{
+		value = 0;
+		return true;
+	}
+
+	if (ones (value) == 9)
+		value = make (tens (value) + 1, 0);
+	else
+		++value;
+
+	return false;
+}
+
+
+/**
+ * Decrement value, wrapping to max (given in BCD) below 0.
+ * Return true if it wrapped.
+ */
+constexpr bool
+decrement (uint8_t& value, uint8_t max)
+{
+	if (value == 0)
+	{
+		value = max;
+		return true;
+	}
+
+	if (ones (value) == 0)
+		value = make (tens (value) - 1, 9);
+	else
+		--value;
+
+	return false;
+}
+
+
+/**
+ * Compute (a - b - borrow) modulo given modulus (given in BCD, eg. 0x60 for minutes).
+ * Set borrow to true if the result wrapped, false otherwise.
+ */
+constexpr uint8_t
+subtract (uint8_t a, uint8_t b, bool& borrow, uint8_t modulus)
+{
+	int8_t lo = ones (a) - ones (b) - borrow;
+	int8_t hi = tens (a) - tens (b);
+
+	if (lo < 0)
+	{
+		lo += 10;
+		--hi;
+	}
+
+	borrow = hi < 0;
+
+	if (borrow)
+	{
+		lo += ones (modulus);
+		hi += tens (modulus);
+
+		if (lo > 9)
+		{
+			lo -= 10;
+			++hi;
+		}
+	}
+
+	return make (hi, lo);
+}
+
+} // namespace bcd
+
+#endif
+
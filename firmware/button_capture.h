@@ -0,0 +1,265 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__BUTTON_CAPTURE__INCLUDED
+#define CLOCK_1337__BUTTON_CAPTURE__INCLUDED
+
+/**
+ * Button on ICP1 (PD4), timestamped by Timer1 input capture.
+ *
+ * Each edge is captured by hardware with 1 µs resolution (see SystemClock),
+ * so timestamps don't depend on when the main loop gets to look at the pin.
+ * Debouncing is done on timestamps too: each edge (re)arms compare-match C
+ * for the debounce time, and when it fires with no edges in between, the pin
+ * level is accepted. Accepted edge is timestamped with the first edge of
+ * the burst, that is when the contact was actually made or broken.
+ *
+ * Accepted edges go to GestureRecognizer right in the interrupt. While it
+ * needs ticks, compare-match C keeps firing every kTickMs; otherwise it's
+ * off, so an idle button costs nothing. Recognized gestures are queued
+ * for the main loop. Button is active-low.
+ */
+class ButtonCapture
+{
+	static constexpr uint16_t	kTickMs			{ 10 };
+	static constexpr uint8_t	kQueueSize		{ 8 };
+
+  public:
+	static constexpr MCU::Pin	kPin			{ MCU::port_d.pin (4) };
+
+	using Gesture = GestureRecognizer::Gesture;
+
+  public:
+	/**
+	 * Start capturing. SystemClock must be initialized first.
+	 * Global interrupts must be enabled separately.
+	 * Threshold is the time between press levels (see GestureRecognizer).
+	 */
+	static void
+	initialize (uint16_t debounce_ms, uint16_t threshold_ms, uint16_t double_click_ms);
+
+	/**
+	 * Set new debounce time, max. 65 ms.
+	 */
+	static void
+	set_debounce_ms (uint16_t);
+
+	/**
+	 * Take the oldest queued gesture. Return false if there are none.
+	 * Doesn't disable interrupts.
+	 */
+	static bool
+	read_gesture (Gesture&);
+
+	/**
+	 * Return number of gestures lost because the main loop didn't keep up.
+	 */
+	static uint8_t
+	dropped_gestures();
+
+	/**
+	 * Timer1 input-capture interrupt handler.
+	 */
+	static void
+	handle_capture_interrupt();
+
+	/**
+	 * Timer1 compare-match C interrupt handler: end of debounce time or gesture tick.
+	 */
+	static void
+	handle_timer_interrupt();
+
+  private:
+	/**
+	 * Queue recognized gestures.
+	 */
+	static void
+	push (GestureRecognizer::Gestures const&);
+
+	/**
+	 * Keep compare-match C firing every kTickMs while the recognizer needs ticks.
+	 */
+	static void
+	schedule_tick();
+
+	/**
+	 * Capture the edge opposite to the current pin level.
+	 */
+	static void
+	capture_next_edge (bool level);
+
+  private:
+	static uint16_t volatile	_debounce_us;
+	// Used only by the interrupts:
+	static bool					_stable_level;
+	static bool					_bouncing;
+	static uint32_t				_burst_start_us;
+	static GestureRecognizer	_recognizer;
+	// Written by the interrupts, read by read_gesture():
+	static SPSCQueue<Gesture, kQueueSize>
+								_gestures;
+};
+
+
+constexpr MCU::Pin ButtonCapture::kPin;
+
+uint16_t volatile ButtonCapture::_debounce_us = 0;
+bool ButtonCapture::_stable_level = true;
+bool ButtonCapture::_bouncing = false;
+uint32_t ButtonCapture::_burst_start_us = 0;
+GestureRecognizer ButtonCapture::_recognizer { 1000, 0 };
+SPSCQueue<ButtonCapture::Gesture, ButtonCapture::kQueueSize> ButtonCapture::_gestures;
+
+
+ISR (TIMER1_CAPT_vect)
+{
+	ButtonCapture::handle_capture_interrupt();
+}
+
+
+ISR (TIMER1_COMPC_vect)
+{
+	ButtonCapture::handle_timer_interrupt();
+}
+
+
+void
+ButtonCapture::initialize (uint16_t debounce_ms, uint16_t threshold_ms, uint16_t double_click_ms)
+{
+	set_debounce_ms (debounce_ms);
+
+	kPin = false;
+	kPin.configure_as_input();
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		_recognizer = GestureRecognizer (threshold_ms, double_click_ms);
+		_stable_level = kPin.get();
+
+		// Button held down since power-on counts as a press:
+		if (!_stable_level)
+		{
+			push (_recognizer.press (SystemClock::timestamp (TCNT1)));
+			OCR1C = TCNT1;
+			schedule_tick();
+		}
+
+		// Noise canceler costs 4 clock cycles of delay, irrelevant here:
+		TCCR1B |= 1 << ICNC1;
+		capture_next_edge (_stable_level);
+		TIMSK1 |= 1 << ICIE1;
+	}
+}
+
+
+inline void
+ButtonCapture::set_debounce_ms (uint16_t debounce_ms)
+{
+	_debounce_us = debounce_ms < 65 ? debounce_ms * 1000U : 65000U;
+}
+
+
+inline bool
+ButtonCapture::read_gesture (Gesture& gesture)
+{
+	return _gestures.pop (gesture);
+}
+
+
+inline uint8_t
+ButtonCapture::dropped_gestures()
+{
+	return _gestures.dropped();
+}
+
+
+inline void
+ButtonCapture::handle_capture_interrupt()
+{
+	uint16_t const captured = ICR1;
+
+	capture_next_edge (kPin.get());
+
+	if (!_bouncing)
+	{
+		_bouncing = true;
+		_burst_start_us = SystemClock::timestamp (captured);
+	}
+
+	// Check the level when it's been stable for the debounce time:
+	OCR1C = captured + _debounce_us;
+	TIFR1 = 1 << OCF1C;
+	TIMSK1 |= 1 << OCIE1C;
+}
+
+
+inline void
+ButtonCapture::handle_timer_interrupt()
+{
+	if (_bouncing)
+	{
+		_bouncing = false;
+
+		bool const level = kPin.get();
+
+		// Burst might have ended at the same level it started with (a glitch):
+		if (level != _stable_level)
+		{
+			_stable_level = level;
+			push (level ? _recognizer.release (_burst_start_us) : _recognizer.press (_burst_start_us));
+		}
+	}
+	else
+		push (_recognizer.tick (SystemClock::timestamp (TCNT1)));
+
+	schedule_tick();
+}
+
+
+inline void
+ButtonCapture::push (GestureRecognizer::Gestures const& gestures)
+{
+	for (uint8_t i = 0; i < gestures.count; ++i)
+		_gestures.push (gestures.list[i]);
+}
+
+
+inline void
+ButtonCapture::schedule_tick()
+{
+	if (_recognizer.needs_ticks())
+	{
+		// Relative to the last compare match, so ticks don't drift:
+		OCR1C += kTickMs * 1000U;
+		TIFR1 = 1 << OCF1C;
+		TIMSK1 |= 1 << OCIE1C;
+	}
+	else
+		TIMSK1 &= ~(1 << OCIE1C);
+}
+
+
+inline void
+ButtonCapture::capture_next_edge (bool level)
+{
+	if (level)
+		TCCR1B &= ~(1 << ICES1);
+	else
+		TCCR1B |= 1 << ICES1;
+
+	// Changing the edge may set the capture flag:
+	TIFR1 = 1 << ICF1;
+}
+
+#endif
+
@@ -0,0 +1,351 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__BUZZER__INCLUDED
+#define CLOCK_1337__BUZZER__INCLUDED
+
+// System:
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+
+/**
+ * Buzzer on PB0, driven by Timer3.
+ *
+ * PB0 is not an output-compare pin, so Timer3 runs in CTC mode with 1 µs
+ * ticks and its compare-match A interrupt toggles the pin every half period
+ * of the tone. The same interrupt counts the beep time down and ends the
+ * beep, so its length doesn't depend on the main loop at all. The last
+ * period is shortened to end the beep exactly on time.
+ *
+ * Tone with frequency 0 is plain DC (for buzzers with their own oscillator);
+ * the interrupt then fires every kDCPeriodUs only to count the time.
+ * Timer3 is stopped when the buzzer is silent.
+ *
+ * Patterns (sequences of notes with gaps) are played by the same interrupt:
+ * when a note or gap ends, the next one is read straight from flash, so
+ * patterns take no RAM and cost nothing in the main loop.
+ */
+class Buzzer
+{
+	static_assert (F_CPU == 8000000L, "Buzzer expects 8 MHz clock (Timer3 prescaler 8 gives 1 µs ticks)");
+
+	static constexpr uint16_t	kDCPeriodUs			{ 1000 };
+	// Compare value must stay ahead of the counter when set in the interrupt,
+	// so periods can't be shorter than the interrupt latency:
+	static constexpr uint16_t	kMinPeriodUs		{ 32 };
+
+  public:
+	static constexpr MCU::Pin	kPin				{ MCU::port_b.pin (0) };
+
+	/**
+	 * Tone to play, see tone().
+	 */
+	struct Tone
+	{
+		// Time between pin toggles, 0 for DC:
+		uint16_t	half_period_us;
+	};
+
+	static constexpr Tone		kDC					{ 0 };
+
+	/**
+	 * Pattern step: tone played for duration_ms, then gap_ms of silence.
+	 * Patterns are arrays of notes in flash, ended with kEndOfPattern.
+	 */
+	struct Note
+	{
+		Tone		tone;
+		uint16_t	duration_ms;
+		uint16_t	gap_ms;
+	};
+
+	static constexpr Note		kEndOfPattern		{ kDC, 0, 0 };
+
+  public:
+	/**
+	 * Return tone of given frequency, 0 means DC.
+	 * Frequencies are limited to 8 Hz…15 kHz. Divides, so meant for compile-time use only.
+	 */
+	static constexpr Tone
+	tone (uint16_t frequency_hz);
+
+	/**
+	 * Configure the pin and Timer3, silent.
+	 */
+	static void
+	initialize();
+
+	/**
+	 * Start playing given tone for given time. Replaces current beep or pattern, if any.
+	 */
+	static void
+	beep (Tone, uint16_t duration_ms);
+
+	/**
+	 * Start playing pattern stored in flash. Replaces current beep or pattern, if any.
+	 */
+	static void
+	play (Note const* pattern_in_flash);
+
+	/**
+	 * End current beep or pattern now.
+	 */
+	static void
+	stop();
+
+	/**
+	 * Return true if a beep or pattern is being played.
+	 */
+	static bool
+	beeping();
+
+	/**
+	 * Timer3 compare-match A interrupt handler.
+	 */
+	static void
+	handle_timer_interrupt();
+
+  private:
+	/**
+	 * Start playing given tone, or silence, for given time.
+	 * Timer3 must be either stopped or just after compare match.
+	 */
+	static void
+	start (Tone, uint16_t duration_ms, bool sounding);
+
+	/**
+	 * Start the gap after the current note or the next note of the pattern.
+	 * Return false if there's nothing more to play.
+	 */
+	static bool
+	advance();
+
+	/**
+	 * Configure and start Timer3 for the already started note.
+	 */
+	static void
+	start_timer();
+
+	/**
+	 * Return time to the next interrupt: half period of the tone,
+	 * or less if the beep ends earlier.
+	 */
+	static uint16_t
+	next_period_us();
+
+  private:
+	// Used only by the interrupt once the beep is started:
+	static uint16_t				_half_period_us;
+	static uint32_t				_remaining_us;
+	static bool					_sounding;
+	static bool					_level;
+	// Gap after the current note:
+	static uint16_t				_gap_ms;
+	// Next note of the pattern in flash or nullptr:
+	static Note const*			_pattern;
+	static bool volatile		_beeping;
+};
+
+
+constexpr MCU::Pin Buzzer::kPin;
+constexpr Buzzer::Tone Buzzer::kDC;
+constexpr Buzzer::Note Buzzer::kEndOfPattern;
+
+uint16_t Buzzer::_half_period_us = 0;
+uint32_t Buzzer::_remaining_us = 0;
+bool Buzzer::_sounding = false;
+bool Buzzer::_level = false;
+uint16_t Buzzer::_gap_ms = 0;
+Buzzer::Note const* Buzzer::_pattern = nullptr;
+bool volatile Buzzer::_beeping = false;
+
+
+ISR (TIMER3_COMPA_vect)
+{
+	Buzzer::handle_timer_interrupt();
+}
+
+
+constexpr auto
+Buzzer::tone (uint16_t frequency_hz) -> Tone
+{
+	return frequency_hz == 0 ? kDC
+		: frequency_hz < 8 ? Tone { 0xffff }
+		: (500000UL + frequency_hz / 2) / frequency_hz < kMinPeriodUs ? Tone { kMinPeriodUs }
+		: Tone { static_cast<uint16_t> ((500000UL + frequency_hz / 2) / frequency_hz) };
+}
+
+
+inline void
+Buzzer::initialize()
+{
+	kPin = false;
+	kPin.configure_as_output();
+	stop();
+}
+
+
+inline void
+Buzzer::beep (Tone tone, uint16_t duration_ms)
+{
+	if (duration_ms == 0)
+		return;
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		_gap_ms = 0;
+		_pattern = nullptr;
+		start (tone, duration_ms, true);
+		start_timer();
+	}
+}
+
+
+inline void
+Buzzer::play (Note const* pattern_in_flash)
+{
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		_gap_ms = 0;
+		_pattern = pattern_in_flash;
+
+		if (advance())
+			start_timer();
+		else
+			stop();
+	}
+}
+
+
+inline void
+Buzzer::stop()
+{
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		TCCR3B = 0;
+		TIMSK3 &= ~(1 << OCIE3A);
+		_gap_ms = 0;
+		_pattern = nullptr;
+		_beeping = false;
+		kPin = false;
+	}
+}
+
+
+inline bool
+Buzzer::beeping()
+{
+	return _beeping;
+}
+
+
+inline void
+Buzzer::handle_timer_interrupt()
+{
+	// Period that has just ended:
+	uint16_t const elapsed_us = OCR3A + 1;
+
+	if (_remaining_us < static_cast<uint32_t> (elapsed_us) + kMinPeriodUs)
+	{
+		if (!advance())
+			stop();
+
+		return;
+	}
+
+	_remaining_us -= elapsed_us;
+
+	if (_sounding && _half_period_us != 0)
+	{
+		_level = !_level;
+		kPin = _level;
+	}
+
+	// Counter has just been cleared, so the new value is still ahead of it:
+	OCR3A = next_period_us() - 1;
+}
+
+
+inline void
+Buzzer::start (Tone tone, uint16_t duration_ms, bool sounding)
+{
+	_half_period_us = tone.half_period_us;
+	_remaining_us = duration_ms * 1000UL;
+	_sounding = sounding;
+	_level = sounding;
+	_beeping = true;
+	kPin = sounding;
+	OCR3A = next_period_us() - 1;
+}
+
+
+inline bool
+Buzzer::advance()
+{
+	if (_gap_ms != 0)
+	{
+		start (kDC, _gap_ms, false);
+		_gap_ms = 0;
+		return true;
+	}
+
+	if (_pattern)
+	{
+		Note note;
+		memcpy_P (&note, _pattern, sizeof (note));
+
+		if (note.duration_ms != 0)
+		{
+			++_pattern;
+			_gap_ms = note.gap_ms;
+			start (note.tone, note.duration_ms, true);
+			return true;
+		}
+
+		_pattern = nullptr;
+	}
+
+	return false;
+}
+
+
+inline void
+Buzzer::start_timer()
+{
+	// CTC mode, stopped while it's being set up:
+	TCCR3B = 1 << WGM32;
+	TCCR3A = 0;
+	TCNT3 = 0;
+	TIFR3 = 1 << OCF3A;
+	TIMSK3 |= 1 << OCIE3A;
+	// Prescaler 8:
+	TCCR3B = (1 << WGM32) | (1 << CS31);
+}
+
+
+inline uint16_t
+Buzzer::next_period_us()
+{
+	uint16_t const period_us = _half_period_us != 0 ? _half_period_us : kDCPeriodUs;
+
+	return _remaining_us < period_us ? static_cast<uint16_t> (_remaining_us) : period_us;
+}
+
+
+static_assert (Buzzer::tone (1000).half_period_us == 500, "tone period is wrong");
+static_assert (Buzzer::tone (3000).half_period_us == 167, "tone period is not rounded");
+static_assert (Buzzer::tone (40000).half_period_us == 32, "tone period is not limited");
+
+#endif
+
@@ -26,22 +26,23 @@ using namespace mulabs::avr;
  */
 class Clock
 {
-	static constexpr uint16_t	kClickSoundMs			{ 4 };
-	static constexpr uint16_t	kShortBeepMs			{ 1000 / 10 };
-	static constexpr uint16_t	kLongBeepMs				{ 400 };
-	static constexpr uint32_t	kBouncingTimeMs			{ 5 };
-	static constexpr uint32_t	kButtonThresholdMs		{ 1000 };
-	static constexpr Time		kMagicTimeOfDay			{ 13, 37, 00 };
-	static constexpr uint8_t	kChangePrecisionPushLen	{ 1 };
-	static constexpr uint8_t	kNumberUpPushLen		{ 1 };
-	static constexpr uint8_t	kNextPushLen			{ 2 };
-	static constexpr uint8_t	kChangeModePushLen		{ 2 };
-	static constexpr uint8_t	kChangeBeepSettings		{ 3 };
-	static constexpr uint8_t	kEnterSetupPushLength	{ 4 };
-
-	static constexpr MCU::Pin	_buzzer					{ MCU::port_b.pin (0) };
+	static constexpr uint16_t	kBouncingTimeMs			{ 5 };
+	static constexpr uint16_t	kButtonThresholdMs		{ 1000 };
+	static constexpr uint16_t	kDoubleClickMs			{ 300 };
+	static constexpr Time		kMagicTimeOfDay			{ 0x13, 0x37, 0x00 };
+	static constexpr uint16_t	kDisplayRefreshRateHz	{ 200 };
+	static constexpr uint16_t	kMarqueeStepMs			{ 300 };
+	// Beep and RTC edge further apart than this don't belong to the same second:
+	static constexpr int32_t	kMaxBeepLatencyUs		{ 500000 };
+	// Extra buttons are debounced over PortDebouncer::kSamplesCount samples taken this often:
+	static constexpr uint16_t	kButtonSamplePeriodMs	{ 2 };
+
 	static constexpr MCU::Pin	_trigger_out			{ MCU::port_e.pin (6) };
-	static constexpr MCU::Pin	_switch_pin				{ MCU::port_d.pin (4) };
+	// Extra buttons, on PIND:
+	static constexpr MCU::Pin	_up_button				{ MCU::port_d.pin (0) };
+	static constexpr MCU::Pin	_down_button			{ MCU::port_d.pin (5) };
+	static constexpr uint8_t	kUpButtonMask			{ 1 << 0 };
+	static constexpr uint8_t	kDownButtonMask			{ 1 << 5 };
 
 	enum class ClockMode
 	{
@@ -83,6 +84,91 @@ class Clock
 		Minutes1,
 	};
 
+	using UiState		= ui::State;
+	using UiEvent		= ui::Event;
+	using UiAction		= ui::Action;
+	using UiTransition	= ui::Transition;
+
+	/**
+	 * Dimming schedule entry: from given time of day on (packed BCD), use given brightness.
+	 */
+	struct DimmingPoint
+	{
+		uint8_t	hours;
+		uint8_t	minutes;
+		uint8_t	brightness;
+	};
+
+	// Messages, kept in flash:
+	static constexpr font::Text<4>	kNormText		PROGMEM { font::render ("NOR ") };
+	static constexpr font::Text<4>	kLeetText		PROGMEM { font::render ("LEET") };
+	static constexpr font::Text<4>	kBeepText		PROGMEM { font::render ("BEEP") };
+	static constexpr font::Text<4>	kSetText		PROGMEM { font::render ("SET ") };
+	// Scrolled, must be of equal length:
+	static constexpr font::Text<8>	kBeepOnText		PROGMEM { font::render ("BEEP ON ") };
+	static constexpr font::Text<8>	kBeepOffText	PROGMEM { font::render ("BEEP OFF") };
+
+	static_assert (kBeepOnText.kLength == kBeepOffText.kLength, "beep setup messages share the marquee");
+
+	// Countdown beep patterns, kept in flash:
+	static constexpr Buzzer::Note	kClickPattern[]		PROGMEM = {
+		{ Buzzer::kDC, 4, 0 },
+		Buzzer::kEndOfPattern,
+	};
+	static constexpr Buzzer::Note	kShortBeepPattern[]	PROGMEM = {
+		{ Buzzer::kDC, 100, 0 },
+		Buzzer::kEndOfPattern,
+	};
+	static constexpr Buzzer::Note	kMagicTimePattern[]	PROGMEM = {
+		{ Buzzer::kDC, 400, 0 },
+		Buzzer::kEndOfPattern,
+	};
+
+	// Must be sorted and start at midnight:
+	static constexpr DimmingPoint kDimmingSchedule[] = {
+		{ 0x00, 0x00, 1 },
+		{ 0x06, 0x30, 6 },
+		{ 0x08, 0x00, Display::kBrightnessLevels - 1 },
+		{ 0x20, 0x00, 8 },
+		{ 0x22, 0x00, 3 },
+	};
+
+	/**
+	 * Everything the displayed picture depends on.
+	 */
+	struct RenderInputs
+	{
+		Time				time;
+		Time				setup_time;
+		ClockMode			clock_mode;
+		DisplayMode			display_mode;
+		DisplayPrecision	display_precision;
+		DisplayOverride		display_override;
+		SetupDigit			setup_digit;
+		bool				beeper_enabled;
+		uint8_t				brightness;
+		int8_t				marquee_offset;
+		// State of the blinker used by the last rendered picture:
+		bool				blink;
+
+		bool
+		operator== (RenderInputs const& other) const;
+	};
+
+	struct RenderStatistics
+	{
+		// Renders and render checks counted during the current second:
+		uint16_t	renders				= 0;
+		uint16_t	checks				= 0;
+		// Totals from the previous second:
+		uint16_t	renders_per_second	= 0;
+		uint16_t	checks_per_second	= 0;
+	};
+
+	using TaskScheduler = Scheduler<Clock, 4>;
+
+	static TaskScheduler::Task const kTasks[TaskScheduler::kTasksCount];
+
   public:
 	// Ctor
 	Clock();
@@ -92,17 +178,93 @@ class Clock
 
   private:
 	void
-	request_beep (uint16_t milliseconds);
+	update_time();
+
+	/**
+	 * Update display brightness from kDimmingSchedule, if minute has changed
+	 * since the last check.
+	 */
+	void
+	update_brightness();
 
+	/**
+	 * Schedule countdown beeps due at the next second edge.
+	 */
+	void
+	schedule_beeps();
+
+	/**
+	 * Return beep pattern for the second at which given time is shown, or nullptr.
+	 * Countdown must correspond to the time.
+	 */
+	Buzzer::Note const*
+	beep_pattern (Time const&, Countdown const&) const;
+
+	/**
+	 * Pair started beeps with measured RTC second edges
+	 * and add their differences to _beep_latency.
+	 */
 	void
-	handle_buzzer();
+	record_beep_latency();
 
+	/**
+	 * Handle queued button gestures and extra button presses.
+	 */
 	void
 	handle_button();
 
+	void
+	handle_gesture (ButtonCapture::Gesture const&);
+
+	/**
+	 * Look up the transition for given event in ui::kTable, run its action and switch state.
+	 */
+	void
+	handle_ui_event (UiEvent);
+
+	void
+	run_ui_action (UiAction);
+
+	/**
+	 * Return UI state for current clock mode and setup digit.
+	 */
+	UiState
+	ui_state() const;
+
+	/**
+	 * Set clock mode and setup digit for given UI state.
+	 */
+	void
+	set_ui_state (UiState);
+
+	/**
+	 * Sample extra buttons. Run at fixed rate.
+	 */
+	void
+	sample_buttons();
+
+	/**
+	 * Increment or decrement currently edited digit of the setup time, wrapping around.
+	 */
+	void
+	step_setup_digit (bool up);
+
+	/**
+	 * Rebuild and publish display contents, if any of render inputs has changed.
+	 */
 	void
 	update_display();
 
+	RenderInputs
+	render_inputs() const;
+
+	/**
+	 * Return blinker state for the picture being rendered.
+	 * Remembers the modulo, so that the picture is rebuilt when blinker state changes.
+	 */
+	bool
+	blink (uint8_t modulo);
+
 	void
 	print_clocks();
 
@@ -117,30 +279,95 @@ class Clock
 	DisplayMode			_display_mode		{ DisplayMode::Leet };
 	DisplayPrecision	_display_precision	{ DisplayPrecision::HoursMinutes };
 	DisplayOverride		_display_override	{ DisplayOverride::None };
-	LoopCalibrator		_calibrator;
 	RTC					_rtc;
-	Switch				_switch				{ _switch_pin, 1000, 1000 };
+	RTCTransaction		_rtc_transaction	{ _rtc };
+	TimeKeeper			_time_keeper		{ _rtc, _rtc_transaction };
+	// Ignore gestures until the current press ends:
+	bool				_ignore_press		{ false };
+	PortDebouncer		_extra_buttons		{ kUpButtonMask | kDownButtonMask };
 	Display				_display;
 	Time				_time;
+	Countdown			_countdown			{ kMagicTimeOfDay };
 	// Related to time setup:
 	Time				_setup_time;
 	SetupDigit			_setup_digit		{ SetupDigit::Hours10 };
-	uint16_t			_requested_beep		{ 0 };
-	Time				_last_beep_time;
+	// Related to rendering:
+	RenderInputs		_rendered_inputs;
+	bool				_render_forced		{ true };
+	uint16_t			_render_phase		{ 0 };
+	uint8_t				_blink_modulo		{ 0 };
+	RenderStatistics	_render_statistics;
+	Marquee				_marquee			{ kBeepOnText.kLength, Display::kDigitsCount, kMarqueeStepMs };
 	bool				_beeper_enabled		{ true };
+	// Beep start vs. RTC second edge, for the record:
+	LatencyHistogram	_beep_latency;
+	uint32_t			_beep_started_us	{ 0 };
+	bool				_beep_started		{ false };
+	uint32_t			_rtc_edge_us		{ 0 };
+	bool				_rtc_edge_measured	{ false };
+	uint8_t				_brightness			{ Display::kBrightnessLevels - 1 };
+	// Time when the dimming schedule was last checked, 0xff means never:
+	uint8_t				_dimming_hours		{ 0xff };
+	uint8_t				_dimming_minutes	{ 0xff };
+	TaskScheduler		_scheduler			{ *this, kTasks };
+
+};
+
+
+constexpr MCU::Pin Clock::_up_button;
+constexpr MCU::Pin Clock::_down_button;
+constexpr Clock::DimmingPoint Clock::kDimmingSchedule[];
+constexpr font::Text<4> Clock::kNormText;
+constexpr font::Text<4> Clock::kLeetText;
+constexpr font::Text<4> Clock::kBeepText;
+constexpr font::Text<4> Clock::kSetText;
+constexpr font::Text<8> Clock::kBeepOnText;
+constexpr font::Text<8> Clock::kBeepOffText;
+constexpr Buzzer::Note Clock::kClickPattern[];
+constexpr Buzzer::Note Clock::kShortBeepPattern[];
+constexpr Buzzer::Note Clock::kMagicTimePattern[];
+
+
+// Time is kept locally and the RTC is accessed only around resync points
+// with non-blocking transactions, so time can be updated often to keep
+// second edges precise. Display render check is cheap, the picture is
+// rebuilt only when its inputs change.
+Clock::TaskScheduler::Task const Clock::kTasks[] = {
+	// handler					period [ms]	budget [µs]
+	{ &Clock::update_time,			1,			100 },
+	{ &Clock::handle_button,		1,			200 },
+	{ &Clock::update_display,		1,			1000 },
+	{ &Clock::sample_buttons,		kButtonSamplePeriodMs,	20 },
 };
 
 
-constexpr MCU::Pin Clock::_switch_pin;
+inline bool
+Clock::RenderInputs::operator== (RenderInputs const& other) const
+{
+	return time == other.time &&
+		   setup_time == other.setup_time &&
+		   clock_mode == other.clock_mode &&
+		   display_mode == other.display_mode &&
+		   display_precision == other.display_precision &&
+		   display_override == other.display_override &&
+		   setup_digit == other.setup_digit &&
+		   beeper_enabled == other.beeper_enabled &&
+		   brightness == other.brightness &&
+		   marquee_offset == other.marquee_offset &&
+		   blink == other.blink;
+}
 
 
 Clock::Clock()
 {
-	_buzzer = false;
 	_trigger_out = false;
-
-	_buzzer.configure_as_output();
 	_trigger_out.configure_as_output();
+
+	// Pulled up, active low:
+	_up_button = true;
+	_up_button.configure_as_input();
+	_down_button = true;
+	_down_button.configure_as_input();
 }
 
 
@@ -148,90 +375,247 @@ void
 Clock::loop()
 {
 	_display.set_enabled (true);
+	_display.publish();
+	_display.start_scanning<kDisplayRefreshRateHz>();
+	SystemClock::initialize();
+	Buzzer::initialize();
+	ButtonCapture::initialize (kBouncingTimeMs, kButtonThresholdMs, kDoubleClickMs);
+	sei();
+
+	_time_keeper.start();
+	_time = _time_keeper.now();
+	_countdown.reset (_time);
+	update_brightness();
+	_scheduler.start();
 
 	while (true)
 	{
-		_time = _rtc.get_time();
-
-		// The trigger-out will last for minute:
-		_trigger_out = _clock_mode == ClockMode::DisplayClock && is_alarm();
+		_scheduler.run();
+		// Advance RTC I/O by one clock edge between tasks:
+		_rtc_transaction.step();
+	}
+}
 
-		handle_buzzer();
-		handle_button();
-		update_display();
 
-		_calibrator.calibrate (_time);
+void
+Clock::update_time()
+{
+	if (_time_keeper.update())
+	{
+		_time = _time_keeper.now();
+		_countdown.update (_time);
+		update_brightness();
+		schedule_beeps();
 	}
+
+	record_beep_latency();
+
+	// The trigger-out will last for minute:
+	_trigger_out = _clock_mode == ClockMode::DisplayClock && is_alarm();
+}
+
+
+void
+Clock::update_brightness()
+{
+	if (_time.hours == _dimming_hours && _time.minutes == _dimming_minutes)
+		return;
+
+	_dimming_hours = _time.hours;
+	_dimming_minutes = _time.minutes;
+
+	// BCD values compare the same way as binary ones:
+	for (auto const& point: kDimmingSchedule)
+		if (point.hours < _time.hours || (point.hours == _time.hours && point.minutes <= _time.minutes))
+			_brightness = point.brightness;
 }
 
 
 void
-Clock::request_beep (uint16_t milliseconds)
+Clock::schedule_beeps()
 {
-	if (_beeper_enabled && _calibrator.calibrated())
+	Time next_time = _time;
+	next_time.increment_seconds();
+	Countdown next_countdown = _countdown;
+	next_countdown.decrement();
+
+	Buzzer::Note const* const pattern = beep_pattern (next_time, next_countdown);
+
+	if (pattern && _beeper_enabled)
 	{
-		auto len = static_cast<float> (milliseconds) * _calibrator.cycles_per_second() / 1000L;
+		EdgeBeeper::schedule (_time_keeper.next_edge_us(), pattern);
+		// Check the beep against the RTC:
+		_time_keeper.request_edge_measurement();
+	}
+	else
+		EdgeBeeper::cancel();
+}
+
+
+Buzzer::Note const*
+Clock::beep_pattern (Time const& time, Countdown const& countdown) const
+{
+	if (_clock_mode != ClockMode::DisplayClock || _display_mode != DisplayMode::Leet)
+		return nullptr;
 
-		if (len > _requested_beep)
-			_requested_beep = len;
+	if (countdown.less_than_minutes (10))
+	{
+		uint16_t const left_secs = countdown.left_seconds();
+
+		// Beep on T-60 and T-30 s marks:
+		if (left_secs == 60 || left_secs == 30)
+			return kClickPattern;
+		// Longer beeps on T-5…T-1 s:
+		else if (left_secs < 5)
+			return kShortBeepPattern;
 	}
+	// Longer beep at 13:37:
+	else if (time == kMagicTimeOfDay)
+		return kMagicTimePattern;
+
+	return nullptr;
 }
 
 
 void
-Clock::handle_buzzer()
+Clock::record_beep_latency()
 {
-	_buzzer = _requested_beep > 0;
+	uint32_t time_us;
+
+	if (EdgeBeeper::take_started (time_us))
+	{
+		_beep_started_us = time_us;
+		_beep_started = true;
+	}
+
+	if (_time_keeper.take_measured_edge (time_us))
+	{
+		_rtc_edge_us = time_us;
+		_rtc_edge_measured = true;
+	}
 
-	if (_requested_beep > 0)
-		_requested_beep--;
+	if (!_beep_started || !_rtc_edge_measured)
+		return;
+
+	int32_t const latency_us = static_cast<int32_t> (_beep_started_us - _rtc_edge_us);
+
+	// Either might come first; if they're too far apart, drop the older one and wait for its pair:
+	if (latency_us > kMaxBeepLatencyUs)
+		_rtc_edge_measured = false;
+	else if (latency_us < -kMaxBeepLatencyUs)
+		_beep_started = false;
+	else
+	{
+		_beep_latency.add (latency_us);
+		_beep_started = false;
+		_rtc_edge_measured = false;
+	}
 }
 
 
 void
 Clock::handle_button()
 {
-	auto const n = _calibrator.cycles_per_second();
+	uint8_t const extra_presses = _extra_buttons.take_presses();
 
-	_switch.set_debounce_samples (n / (1000L / kBouncingTimeMs));
-	_switch.set_threshold_samples (n / (1000L / kButtonThresholdMs));
-	_switch.sample();
+	if (extra_presses & kUpButtonMask)
+		handle_ui_event (UiEvent::Up);
 
-	auto const push_length = _switch.push_length();
+	if (extra_presses & kDownButtonMask)
+		handle_ui_event (UiEvent::Down);
 
-	if (_clock_mode == ClockMode::DisplayClock)
+	ButtonCapture::Gesture gesture;
+
+	while (ButtonCapture::read_gesture (gesture))
+		handle_gesture (gesture);
+}
+
+
+void
+Clock::handle_gesture (ButtonCapture::Gesture const& gesture)
+{
+	using Type = GestureRecognizer::Type;
+
+	bool const released = gesture.type == Type::Click || gesture.type == Type::Release;
+	// Level 2…4, as offset from the Hold2/Release2 event:
+	uint8_t const level_offset = (gesture.level < 4 ? gesture.level : 4) - 2;
+
+	if (_ignore_press)
 	{
-		if (push_length > 0)
-		{
-			if (push_length == kChangeModePushLen)
-			{
-				switch (_display_mode)
-				{
-					case DisplayMode::Leet:
-						_display_override = DisplayOverride::Norm;
-						break;
+		if (released)
+			_ignore_press = false;
 
-					case DisplayMode::Normal:
-						_display_override = DisplayOverride::Leet;
-						break;
-				}
-			}
-			else if (push_length == kChangeBeepSettings)
-				_display_override = DisplayOverride::Beep;
-			else if (push_length >= kEnterSetupPushLength)
-				_display_override = DisplayOverride::Set;
-		}
-		else
-			_display_override = DisplayOverride::None;
+		return;
 	}
 
-	auto const last_press_length = _switch.report_last_press_length();
-	auto const current_press_length = _switch.report_current_press_length();
+	if (released)
+		_display_override = DisplayOverride::None;
 
-	if (_clock_mode == ClockMode::DisplayClock)
+	switch (gesture.type)
 	{
-		if (last_press_length == kChangePrecisionPushLen)
-		{
+		case Type::Click:
+			handle_ui_event (UiEvent::Click);
+			break;
+
+		case Type::LongPress:
+			handle_ui_event (static_cast<UiEvent> (static_cast<uint8_t> (UiEvent::Hold2) + level_offset));
+			break;
+
+		case Type::Release:
+			handle_ui_event (static_cast<UiEvent> (static_cast<uint8_t> (UiEvent::Release2) + level_offset));
+			break;
+
+		case Type::DoubleClick:
+			// Not used, both clicks are handled on their own.
+			break;
+	}
+}
+
+
+void
+Clock::handle_ui_event (UiEvent event)
+{
+	UiTransition transition;
+	memcpy_P (&transition, &ui::kTable[static_cast<uint8_t> (ui_state())][static_cast<uint8_t> (event)], sizeof (transition));
+
+	run_ui_action (transition.action);
+	set_ui_state (transition.next);
+
+	if (transition.ignore_press)
+		_ignore_press = true;
+}
+
+
+void
+Clock::run_ui_action (UiAction action)
+{
+	switch (action)
+	{
+		case UiAction::None:
+			break;
+
+		case UiAction::ShowModeOverride:
+			switch (_display_mode)
+			{
+				case DisplayMode::Leet:
+					_display_override = DisplayOverride::Norm;
+					break;
+
+				case DisplayMode::Normal:
+					_display_override = DisplayOverride::Leet;
+					break;
+			}
+			break;
+
+		case UiAction::ShowBeepOverride:
+			_display_override = DisplayOverride::Beep;
+			break;
+
+		case UiAction::ShowSetOverride:
+			_display_override = DisplayOverride::Set;
+			break;
+
+		case UiAction::TogglePrecision:
 			switch (_display_precision)
 			{
 				case DisplayPrecision::HoursMinutes:
@@ -242,9 +626,9 @@ Clock::handle_button()
 					_display_precision = DisplayPrecision::HoursMinutes;
 					break;
 			}
-		}
-		else if (last_press_length == kChangeModePushLen)
-		{
+			break;
+
+		case UiAction::ToggleDisplayMode:
 			switch (_display_mode)
 			{
 				case DisplayMode::Leet:
@@ -255,121 +639,150 @@ Clock::handle_button()
 					_display_mode = DisplayMode::Leet;
 					break;
 			}
-		}
-		else if (last_press_length == kChangeBeepSettings)
-		{
-			_clock_mode = ClockMode::BeepSetup;
-		}
-		else if (last_press_length >= kEnterSetupPushLength)
-		{
-			_clock_mode = ClockMode::TimeSetup;
+			break;
+
+		case UiAction::EnterBeepSetup:
+			_marquee.restart (SystemClock::millis());
+			break;
+
+		case UiAction::ToggleBeeper:
+			_beeper_enabled = !_beeper_enabled;
+			break;
+
+		case UiAction::EnterTimeSetup:
 			_setup_time = _time;
-			_setup_digit = SetupDigit::Hours10;
-		}
+			break;
+
+		case UiAction::DigitUp:
+			step_setup_digit (true);
+			break;
+
+		case UiAction::DigitDown:
+			step_setup_digit (false);
+			break;
+
+		case UiAction::NextDigit:
+			_setup_time.sanitize();
+			break;
+
+		case UiAction::CommitTime:
+			_setup_time.seconds = 0;
+			_setup_time.sanitize();
+			_time_keeper.set_time (_setup_time);
+			_time = _time_keeper.now();
+			_countdown.reset (_time);
+			update_brightness();
+			break;
 	}
-	else if (_clock_mode == ClockMode::BeepSetup)
+}
+
+
+inline auto
+Clock::ui_state() const -> UiState
+{
+	switch (_clock_mode)
 	{
-		if (last_press_length == 1)
-			_beeper_enabled = !_beeper_enabled;
-		else if (current_press_length > 1)
-		{
-			_clock_mode = ClockMode::DisplayClock;
-			_switch.reset_press_state();
-		}
+		case ClockMode::DisplayClock:
+			return UiState::Clock;
+
+		case ClockMode::BeepSetup:
+			return UiState::BeepSetup;
+
+		default:
+			return static_cast<UiState> (static_cast<uint8_t> (UiState::SetupHours10) + static_cast<uint8_t> (_setup_digit));
 	}
-	else if (_clock_mode == ClockMode::TimeSetup)
+}
+
+
+inline void
+Clock::set_ui_state (UiState state)
+{
+	switch (state)
 	{
-		if (last_press_length == kNumberUpPushLen)
-		{
-			switch (_setup_digit)
-			{
-				case SetupDigit::Hours10:
-				{
-					auto h = _setup_time.hours / 10;
-					h = (h + 1) % 3;
-					_setup_time.hours = 10 * h + _setup_time.hours % 10;
-					break;
-				}
+		case UiState::Clock:
+			_clock_mode = ClockMode::DisplayClock;
+			break;
 
-				case SetupDigit::Hours1:
-				{
-					auto const h10 = _setup_time.hours / 10;
-					auto h = _setup_time.hours % 10;
+		case UiState::BeepSetup:
+			_clock_mode = ClockMode::BeepSetup;
+			break;
 
-					if (h10 == 2)
-						h = (h + 1) % 4;
-					else
-						h = (h + 1) % 10;
+		default:
+			_clock_mode = ClockMode::TimeSetup;
+			_setup_digit = static_cast<SetupDigit> (static_cast<uint8_t> (state) - static_cast<uint8_t> (UiState::SetupHours10));
+			break;
+	}
+}
 
-					_setup_time.hours = _setup_time.hours / 10 * 10 + h;
-					break;
-				}
 
-				case SetupDigit::Minutes10:
-				{
-					auto m = _setup_time.minutes / 10;
-					m = (m + 1) % 6;
-					_setup_time.minutes = 10 * m + _setup_time.minutes % 10;
-					break;
-				}
+void
+Clock::sample_buttons()
+{
+	_extra_buttons.sample (PIND);
+}
 
-				case SetupDigit::Minutes1:
-				{
-					auto m = _setup_time.minutes % 10;
-					m = (m + 1) % 10;
-					_setup_time.minutes = _setup_time.minutes / 10 * 10 + m;
-					break;
-				}
-			}
-		}
-		else if (last_press_length >= kNextPushLen)
-		{
-			if (_setup_digit == SetupDigit::Minutes1)
-			{
-				_setup_time.seconds = 0;
-				_setup_time.sanitize();
-				_rtc.set_time (_setup_time);
-				_calibrator.reset();
-				_switch.reset_press_state();
-				_clock_mode = ClockMode::DisplayClock;
-			}
-		}
-		// Checking push_length() instead of last_press_length to switch to next digit
-		// as soon as pressing time is enough (ie. not waiting for button release).
-		else if (current_press_length >= kNextPushLen)
-		{
-			if (_setup_digit != SetupDigit::Minutes1)
-			{
-				_setup_time.sanitize();
-				// Clear last-press-length buffer:
-				_switch.reset_press_state();
-			}
 
-			switch (_setup_digit)
-			{
-				case SetupDigit::Hours10:
-					_setup_digit = SetupDigit::Hours1;
-					break;
+void
+Clock::step_setup_digit (bool up)
+{
+	uint8_t& value = _setup_digit == SetupDigit::Hours10 || _setup_digit == SetupDigit::Hours1
+		? _setup_time.hours
+		: _setup_time.minutes;
+	bool const tens = _setup_digit == SetupDigit::Hours10 || _setup_digit == SetupDigit::Minutes10;
+	uint8_t digit = tens ? bcd::tens (value) : bcd::ones (value);
+	uint8_t max = 9;
+
+	switch (_setup_digit)
+	{
+		case SetupDigit::Hours10:
+			max = 2;
+			break;
 
-				case SetupDigit::Hours1:
-					_setup_digit = SetupDigit::Minutes10;
-					break;
+		case SetupDigit::Hours1:
+			max = bcd::tens (value) == 2 ? 3 : 9;
+			break;
 
-				case SetupDigit::Minutes10:
-					_setup_digit = SetupDigit::Minutes1;
-					break;
+		case SetupDigit::Minutes10:
+			max = 5;
+			break;
 
-				case SetupDigit::Minutes1:
-					break;
-			}
-		}
+		case SetupDigit::Minutes1:
+			break;
 	}
+
+	if (up)
+		digit = digit < max ? digit + 1 : 0;
+	else
+		digit = digit > 0 ? digit - 1 : max;
+
+	value = tens ? bcd::make (digit, bcd::ones (value)) : bcd::make (bcd::tens (value), digit);
 }
 
 
 void
 Clock::update_display()
 {
+	_render_phase = _time_keeper.phase();
+	_render_statistics.checks++;
+
+	if (_clock_mode == ClockMode::BeepSetup)
+		_marquee.update (SystemClock::millis());
+
+	if (!_render_forced && render_inputs() == _rendered_inputs)
+		return;
+
+	if (_time.seconds != _rendered_inputs.time.seconds)
+	{
+		_render_statistics.renders_per_second = _render_statistics.renders;
+		_render_statistics.checks_per_second = _render_statistics.checks;
+		_render_statistics.renders = 0;
+		_render_statistics.checks = 0;
+	}
+
+	_render_statistics.renders++;
+	_render_forced = false;
+	_blink_modulo = 0;
+
 	switch (_display_override)
 	{
 		case DisplayOverride::None:
@@ -378,30 +791,56 @@ Clock::update_display()
 
 		case DisplayOverride::Norm:
 			_display.set_all_digits_enabled (true);
-			_display.set_digits (Display::Sign::N, Display::Sign::O, Display::Sign::R, Display::Sign::Empty);
-			_display.set_all_dps (false);
+			_display.set_text (kNormText);
 			break;
 
 		case DisplayOverride::Leet:
 			_display.set_all_digits_enabled (true);
-			_display.set_digits (Display::Sign::L, Display::Sign::E, Display::Sign::E, Display::Sign::T);
-			_display.set_all_dps (false);
+			_display.set_text (kLeetText);
 			break;
 
 		case DisplayOverride::Beep:
 			_display.set_all_digits_enabled (true);
-			_display.set_digits (Display::Sign::B, Display::Sign::E, Display::Sign::E, Display::Sign::P);
-			_display.set_all_dps (false);
+			_display.set_text (kBeepText);
 			break;
 
 		case DisplayOverride::Set:
 			_display.set_all_digits_enabled (true);
-			_display.set_digits (Display::Sign::S, Display::Sign::E, Display::Sign::T, Display::Sign::Empty);
-			_display.set_all_dps (false);
+			_display.set_text (kSetText);
 			break;
 	}
 
-	_display.update();
+	_display.set_brightness (_brightness);
+	_display.publish();
+	// Blinker modulo might have changed during rendering:
+	_rendered_inputs = render_inputs();
+}
+
+
+Clock::RenderInputs
+Clock::render_inputs() const
+{
+	RenderInputs inputs;
+	inputs.time = _time;
+	inputs.setup_time = _setup_time;
+	inputs.clock_mode = _clock_mode;
+	inputs.display_mode = _display_mode;
+	inputs.display_precision = _display_precision;
+	inputs.display_override = _display_override;
+	inputs.setup_digit = _setup_digit;
+	inputs.beeper_enabled = _beeper_enabled;
+	inputs.brightness = _brightness;
+	inputs.marquee_offset = _marquee.offset();
+	inputs.blink = _blink_modulo > 0 && TimeKeeper::lit (_render_phase, _blink_modulo);
+	return inputs;
+}
+
+
+inline bool
+Clock::blink (uint8_t modulo)
+{
+	_blink_modulo = modulo;
+	return TimeKeeper::lit (_render_phase, modulo);
 }
 
 
@@ -412,12 +851,6 @@ Clock::print_clocks()
 	{
 		case ClockMode::DisplayClock:
 		{
-			int32_t const total_now = _time.seconds_since_midnight();
-			int32_t const total_magic = kMagicTimeOfDay.seconds_since_midnight();
-			int32_t const diff = total_magic - total_now;
-			int32_t const left_secs = (diff + 86400L - 1) % 86400L;
-			int32_t const right_secs = (-diff + 86400L) % 86400L;
-
 			// Last dot is lit, when Leet mode is active:
 			_display.set_dp (3, _display_mode == DisplayMode::Leet);
 
@@ -425,87 +858,56 @@ Clock::print_clocks()
 			{
 				case DisplayMode::Leet:
 				{
-					Time left_time;
-
-					left_time.hours = left_secs / 3600L;
-					left_time.minutes = (left_secs / 60L) % 60L;
-					left_time.seconds = left_secs % 60L;
+					Time const& left_time = _countdown.left();
 
-					if (left_secs < 10 * 60)
+					if (_countdown.less_than_minutes (10))
 					{
+						uint16_t const left_secs = _countdown.left_seconds();
+
 						// If 10 minutes left, display mm:ss:
-						_display.set_digit (3, left_time.seconds % 10);
-						_display.set_digit (2, left_time.seconds / 10);
-						_display.set_digit (1, left_time.minutes % 10);
+						_display.set_digit (3, bcd::ones (left_time.seconds));
+						_display.set_digit (2, bcd::tens (left_time.seconds));
+						_display.set_digit (1, bcd::ones (left_time.minutes));
 
-						if (left_time.minutes / 10 == 0)
+						if (bcd::tens (left_time.minutes) == 0)
 							_display.set_digit (0, Display::Sign::Minus);
 						else
-							_display.set_digit (0, left_time.minutes / 10);
+							_display.set_digit (0, bcd::tens (left_time.minutes));
 
 						// Make colon blink faster:
-						constexpr int32_t kFastColonThresholdTime = 20;
+						constexpr uint8_t kFastColonThresholdTime = 20;
 
 						if (left_secs > kFastColonThresholdTime)
-							_display.set_colon (_calibrator.lit (2));
+							_display.set_colon (blink (2));
 						else
 						{
-							int32_t mod = (kFastColonThresholdTime - left_secs) / 2 * 2;
-							_display.set_colon (_calibrator.lit (mod + 2));
-						}
-
-						// Beep on T-60 and T-30 s marks:
-						if (left_secs == 60 || left_secs == 30)
-						{
-							if (_time != _last_beep_time)
-							{
-								request_beep (kClickSoundMs);
-								_last_beep_time = _time;
-							}
-						}
-						// Longer beeps on T-5…T-1 s:
-						else if (0 <= left_secs && left_secs < 5)
-						{
-							if (_time != _last_beep_time)
-							{
-								request_beep (kShortBeepMs);
-								_last_beep_time = _time;
-							}
+							uint8_t mod = (kFastColonThresholdTime - left_secs) & ~1;
+							_display.set_colon (blink (mod + 2));
 						}
 					}
-					else if (right_secs < 60)
+					else if (is_alarm())
 					{
-						// Longer beep at 13:37:
-						if (right_secs == 0)
-						{
-							if (_time != _last_beep_time)
-							{
-								request_beep (kLongBeepMs);
-								_last_beep_time = _time;
-							}
-						}
-
 						// BLINKING 13:37
-						bool blink = _calibrator.lit (4);
+						bool const lit = blink (4);
 
-						if (blink)
+						if (lit)
 							_display.set_digits (1, 3, 3, 7);
 						else
 							_display.set_all_digits (Display::Sign::Empty);
 
-						_display.set_colon (blink);
+						_display.set_colon (lit);
 					}
 					else
 					{
 						print_time (left_time, _display_precision);
-						_display.set_colon (_calibrator.lit (2));
+						_display.set_colon (blink (2));
 					}
 					break;
 				}
 
 				case DisplayMode::Normal:
 					print_time (_time, _display_precision);
-					_display.set_colon (_calibrator.lit (2));
+					_display.set_colon (blink (2));
 					break;
 			}
 
@@ -515,21 +917,21 @@ Clock::print_clocks()
 
 		case ClockMode::BeepSetup:
 			if (_beeper_enabled)
-				_display.set_digits (Display::Sign::Empty, Display::Sign::O, Display::Sign::N, Display::Sign::Empty);
+				_display.set_text (kBeepOnText, _marquee.offset());
 			else
-				_display.set_digits (Display::Sign::Empty, Display::Sign::O, Display::Sign::F, Display::Sign::F);
+				_display.set_text (kBeepOffText, _marquee.offset());
 			break;
 
 		case ClockMode::TimeSetup:
 			print_time (_setup_time, DisplayPrecision::HoursMinutes);
 
-			bool blink = _calibrator.lit (10);
+			bool const lit = blink (10);
 
 			_display.set_colon (true);
-			_display.set_digit_enabled (0, blink || _setup_digit != SetupDigit::Hours10);
-			_display.set_digit_enabled (1, blink || _setup_digit != SetupDigit::Hours1);
-			_display.set_digit_enabled (2, blink || _setup_digit != SetupDigit::Minutes10);
-			_display.set_digit_enabled (3, blink || _setup_digit != SetupDigit::Minutes1);
+			_display.set_digit_enabled (0, lit || _setup_digit != SetupDigit::Hours10);
+			_display.set_digit_enabled (1, lit || _setup_digit != SetupDigit::Hours1);
+			_display.set_digit_enabled (2, lit || _setup_digit != SetupDigit::Minutes10);
+			_display.set_digit_enabled (3, lit || _setup_digit != SetupDigit::Minutes1);
 			break;
 	}
 }
@@ -541,11 +943,11 @@ Clock::print_time (Time const& time, DisplayPrecision precision)
 	switch (precision)
 	{
 		case DisplayPrecision::HoursMinutes:
-			_display.set_digits (time.hours / 10L, time.hours % 10L, time.minutes / 10L, time.minutes % 10L);
+			_display.set_digits (bcd::tens (time.hours), bcd::ones (time.hours), bcd::tens (time.minutes), bcd::ones (time.minutes));
 			break;
 
 		case DisplayPrecision::Seconds:
-			_display.set_digits (Display::Sign::Empty, Display::Sign::Empty, time.seconds / 10L, time.seconds % 10L);
+			_display.set_digits (Display::Sign::Empty, Display::Sign::Empty, bcd::tens (time.seconds), bcd::ones (time.seconds));
 			break;
 	}
 }
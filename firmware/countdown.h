@@ -0,0 +1,154 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__COUNTDOWN__INCLUDED
+#define CLOCK_1337__COUNTDOWN__INCLUDED
+
+/**
+ * Time left to a given time of day, kept incrementally.
+ *
+ * Initialized once by BCD subtraction with borrow, then decremented on each
+ * second tick, so no 32-bit division is needed. Left time is packed BCD, like
+ * Time, so it can be displayed without conversions. Left time is counted
+ * the same way as the display shows it: it's 0 during the last second
+ * before the target and 23:59:59 right at the target.
+ */
+class Countdown
+{
+  public:
+	// Ctor
+	explicit constexpr
+	Countdown (Time const& target);
+
+	/**
+	 * Follow current time of day. Decrements if time has advanced
+	 * by one second, recomputes on any other change.
+	 */
+	constexpr void
+	update (Time const& now);
+
+	/**
+	 * Recompute left time for given current time of day.
+	 */
+	constexpr void
+	reset (Time const& now);
+
+	/**
+	 * Decrement left time by one second, wrapping around at 00:00:00.
+	 */
+	constexpr void
+	decrement();
+
+	/**
+	 * Return time left.
+	 */
+	constexpr Time const&
+	left() const;
+
+	/**
+	 * Return true if less than given number of minutes (max. 18) is left.
+	 */
+	constexpr bool
+	less_than_minutes (uint8_t minutes) const;
+
+	/**
+	 * Return binary number of seconds left. Valid only if less_than_minutes (18).
+	 */
+	constexpr uint16_t
+	left_seconds() const;
+
+  private:
+	Time	_target;
+	Time	_now;
+	Time	_left;
+};
+
+
+constexpr
+Countdown::Countdown (Time const& target):
+	_target (target),
+	_now(),
+	_left()
+{
+	reset (_now);
+}
+
+
+constexpr void
+Countdown::update (Time const& now)
+{
+	if (now == _now)
+		return;
+
+	Time next = _now;
+	next.increment_seconds();
+
+	if (now == next)
+	{
+		_now = now;
+		decrement();
+	}
+	else
+		reset (now);
+}
+
+
+constexpr void
+Countdown::reset (Time const& now)
+{
+	_now = now;
+
+	// Count one second less, as the display does:
+	bool borrow = true;
+
+	_left.seconds = bcd::subtract (_target.seconds, now.seconds, borrow, 0x60);
+	_left.minutes = bcd::subtract (_target.minutes, now.minutes, borrow, 0x60);
+	_left.hours = bcd::subtract (_target.hours, now.hours, borrow, 0x24);
+}
+
+
+constexpr void
+Countdown::decrement()
+{
+	if (bcd::decrement (_left.seconds, 0x59))
+		if (bcd::decrement (_left.minutes, 0x59))
+			bcd::decrement (_left.hours, 0x23);
+}
+
+
+constexpr Time const&
+Countdown::left() const
+{
+	return _left;
+}
+
+
+constexpr bool
+Countdown::less_than_minutes (uint8_t minutes) const
+{
+	return _left.hours == 0 && _left.minutes < bcd::from_binary (minutes);
+}
+
+
+constexpr uint16_t
+Countdown::left_seconds() const
+{
+	return 60 * bcd::to_binary (_left.minutes) + bcd::to_binary (_left.seconds);
+}
+
+
+// See host/countdown_test.cc for comparison with the reference formula:
+static_assert (Countdown ({ 0x13, 0x37, 0x00 }).left() == Time { 0x13, 0x36, 0x59 }, "Countdown is wrong at midnight");
+
+#endif
+
@@ -14,327 +14,807 @@
 #ifndef CLOCK_1337__DISPLAY__INCLUDED
 #define CLOCK_1337__DISPLAY__INCLUDED
 
+// Ports that can be used by the display:
+enum class DisplayPort: uint8_t
+{
+	B,
+	C,
+	D,
+	E,
+	F,
+};
+
+
+struct DisplayPin
+{
+	DisplayPort	port;
+	uint8_t		bit;
+};
+
+
 /**
- * Clock display handler.
+ * Pinout of the original 4-digit 1337 clock board.
+ *
+ * Pinout description must provide kDigitPins (one per digit, left to right)
+ * and kSegmentPins (segments a…g, then dp).
  */
-class Display
+struct Clock1337Pinout
 {
-	static constexpr MCU::Pin	_digit1			{ MCU::port_d.pin (7) };
-	static constexpr MCU::Pin	_digit2			{ MCU::port_b.pin (6) };
-	static constexpr MCU::Pin	_digit3			{ MCU::port_c.pin (6) };
-	static constexpr MCU::Pin	_digit4			{ MCU::port_f.pin (7) };
-
-	static constexpr MCU::Pin	_segment_a		{ MCU::port_b.pin (4) };
-	static constexpr MCU::Pin	_segment_b		{ MCU::port_d.pin (6) };
-	static constexpr MCU::Pin	_segment_c		{ MCU::port_f.pin (5) };
-	static constexpr MCU::Pin	_segment_d		{ MCU::port_f.pin (1) };
-	static constexpr MCU::Pin	_segment_e		{ MCU::port_f.pin (0) };
-	static constexpr MCU::Pin	_segment_f		{ MCU::port_b.pin (5) };
-	static constexpr MCU::Pin	_segment_g		{ MCU::port_f.pin (6) };
-	static constexpr MCU::Pin	_segment_dp		{ MCU::port_f.pin (4) };
-
-	static constexpr uint8_t kDigitSymbols[] = {
-		0x3f, // 0 |abcdef |
-		0x06, // 1 | bc    |
-		0x5b, // 2 |ab de g|
-		0x4f, // 3 |abcd  g|
-		0x66, // 4 | bc  fg|
-		0x6d, // 5 |a cd fg|
-		0x7d, // 6 |a cdefg|
-		0x07, // 7 |abc    |
-		0x7f, // 8 |abcdefg|
-		0x6f, // 9 |abcd fg|
-		0x40, // - |      g|
-		0x00, //   |       |
-		0x6d, // S |a cd fg|
-		0x79, // E |a  defg|
-		0x78, // T |   defg|
-		0x54, // N |  c e g|
-		0x5c, // O |  cde g|
-		0x50, // R |    e g|
-		0x38, // L |   def |
-		0x5e, // D | bcde g|
-		0x73, // P |ab  efg|
-		0x7c, // B |  cdefg|
-		0x71, // F |a   efg|
+	static constexpr DisplayPin kDigitPins[] = {
+		{ DisplayPort::D, 7 },
+		{ DisplayPort::B, 6 },
+		{ DisplayPort::C, 6 },
+		{ DisplayPort::F, 7 },
 	};
 
-  public:
-	// Special characters to be displayed:
-	enum class Sign: uint8_t
+	static constexpr DisplayPin kSegmentPins[] = {
+		{ DisplayPort::B, 4 },
+		{ DisplayPort::D, 6 },
+		{ DisplayPort::F, 5 },
+		{ DisplayPort::F, 1 },
+		{ DisplayPort::F, 0 },
+		{ DisplayPort::B, 5 },
+		{ DisplayPort::F, 6 },
+		{ DisplayPort::F, 4 },
+	};
+};
+
+
+constexpr DisplayPin Clock1337Pinout::kDigitPins[];
+constexpr DisplayPin Clock1337Pinout::kSegmentPins[];
+
+
+/**
+ * Multiplexed 7-segment display handler.
+ *
+ * Digits are multiplexed from the Timer0 compare interrupt. Brightness is
+ * controlled with binary-code modulation: time slot of each digit is split
+ * into kModulationBits periods of lengths …, 4, 2, 1 units and the digit is
+ * selected during periods corresponding to set bits of its duty value.
+ * The longest period goes first, since switching digits takes the longest.
+ * That gives 2^kModulationBits duty levels at the cost of kModulationBits
+ * interrupts per digit, regardless of the level.
+ *
+ * Segments are driven directly from port pins, so the more segments a digit
+ * has lit, the less current each of them gets. To compensate, duty of each
+ * digit is scaled by a factor depending on its lit-segments count, and all
+ * factors are scaled down together if needed to keep the average digit-pin
+ * current within DISPLAY_PIN_BUDGET_MA. Refresh rate doesn't change.
+ *
+ * pDigitsCount is the number of digits (eg. 4 for HH:MM, 6 for HH:MM:SS,
+ * 8 for two 4-digit panels sharing segment lines), pPinout is the pinout
+ * description (see Clock1337Pinout).
+ */
+template<uint8_t pDigitsCount, class pPinout>
+	class BasicDisplay: public BasicDisplayContent<pDigitsCount>
 	{
-		Minus	= 10,
-		Empty	= 11,
-		S		= 12,
-		E		= 13,
-		T		= 14,
-		N		= 15,
-		O		= 16,
-		R		= 17,
-		L		= 18,
-		D		= 19,
-		P		= 20,
-		B		= 21,
-		F		= 22,
+		using Base = BasicDisplayContent<pDigitsCount>;
+
+	  public:
+		using Pinout = pPinout;
+
+		using Base::kDigitsCount;
+		using Base::kSegmentsCount;
+
+		// Approximate number of cycles from timer compare match to the point where the interrupt
+		// handler has set up the next period. Time since the match is carried over to the next
+		// period, so it doesn't add to period lengths, but periods must be longer than that:
+		static constexpr uint16_t	kInterruptLatencyCycles	{ 32 };
+
+		// Approximate number of cycles between reading and reloading the timer count in the interrupt
+		// handler, not counted by the timer, so subtracted from each period:
+		static constexpr uint16_t	kCountReloadCycles		{ 6 };
+
+		// Shortest modulation period that leaves enough time for the interrupt handler:
+		static constexpr uint16_t	kMinPeriodCycles		{ 120 };
+
+		// Refresh rate for which the number of modulation bits is chosen; more digits
+		// mean shorter time slots, so fewer bits fit:
+		static constexpr uint32_t	kNominalRefreshRateHz	{ 200 };
+		static constexpr uint32_t	kNominalSlotCycles		{ F_CPU / (kNominalRefreshRateHz * kDigitsCount) };
+
+		static constexpr uint8_t	kModulationBits
+		{
+			kNominalSlotCycles / 63 >= kInterruptLatencyCycles + kMinPeriodCycles ? 6 :
+			kNominalSlotCycles / 31 >= kInterruptLatencyCycles + kMinPeriodCycles ? 5 :
+			4
+		};
+
+	  private:
+		using Base::kGammaBits;
+		using Base::kGammaTable;
+		using Base::_content;
+
+		static constexpr uint8_t	kPortsCount			{ 5 };
+
+		// Current of a single lit segment (set by segment resistors):
+		static constexpr uint32_t	kSegmentCurrentUA		{ 10000 };
+		// Each additional lit segment lowers current of all segments by this amount
+		// (digit pin output voltage drop), in per mille of a single segment current:
+		static constexpr uint32_t	kSegmentDroopPermille	{ 60 };
+		// Allowed average current of a digit pin over the full refresh period:
+#ifdef DISPLAY_PIN_BUDGET_MA
+		static constexpr uint32_t	kPinCurrentBudgetUA		{ 1000UL * DISPLAY_PIN_BUDGET_MA };
+#else
+		static constexpr uint32_t	kPinCurrentBudgetUA		{ 20000 };
+#endif
+
+		static_assert (kModulationBits <= kGammaBits, "gamma table has fewer bits than modulation");
+		static_assert (sizeof (Pinout::kDigitPins) / sizeof (DisplayPin) == kDigitsCount, "pinout must define one pin per digit");
+		static_assert (sizeof (Pinout::kSegmentPins) / sizeof (DisplayPin) == kSegmentsCount, "pinout must define pins for segments a…g and dp");
+
+	  public:
+		/**
+		 * Time spent in the scanning interrupt handler (not counting interrupt entry/exit).
+		 * Collected only if DISPLAY_SCAN_PROFILING is enabled.
+		 */
+		struct ScanStatistics
+		{
+			// Total time during the last full frame (all digits):
+			uint16_t	last_frame_us	= 0;
+			// Maximum of the above:
+			uint16_t	max_frame_us	= 0;
+		};
+
+	  public:
+		/**
+		 * Starts with disabled display.
+		 */
+		BasicDisplay();
+
+		/**
+		 * Make all changes done with set_*() methods visible on the display.
+		 * Until called, the scanning interrupt keeps showing previously published frame.
+		 */
+		void
+		publish();
+
+		/**
+		 * Start scanning digits from the Timer0 compare interrupt.
+		 * RefreshRateHz is the number of full frames (all digits) shown per second.
+		 * Global interrupts must be enabled separately.
+		 */
+		template<uint16_t RefreshRateHz>
+			void
+			start_scanning();
+
+		/**
+		 * Return scanning interrupt cost statistics.
+		 */
+		ScanStatistics
+		scan_statistics() const;
+
+		/**
+		 * Switch to next modulation period, and to next digit after the last period.
+		 * Called from the scanning timer interrupt.
+		 */
+		void
+		update();
+
+		/**
+		 * Scanning timer interrupt handler.
+		 */
+		static void
+		handle_interrupt();
+
+	  private:
+		/**
+		 * Precomputed port values for displaying a single digit.
+		 */
+		struct DigitImage
+		{
+			// Segment bits for each port (digit-select bits cleared):
+			uint8_t	ports[kPortsCount];
+			// Digit-select bit, set after segments are written:
+			uint8_t	select_port;
+			uint8_t	select_mask;
+			// Modulation periods in which the digit is selected:
+			uint8_t	duty;
+		};
+
+		/**
+		 * Everything needed to show one full picture on the display.
+		 */
+		struct Frame
+		{
+			DigitImage	digits[kDigitsCount];
+		};
+
+		/**
+		 * Timer0 setup for a single modulation period.
+		 */
+		struct PeriodTiming
+		{
+			uint8_t	clock_select;
+			// Period length in timer ticks:
+			uint8_t	compare;
+			// Timer ticks counted since the end of the previous period are worth 2^carry_shift ticks
+			// of this one (if negative, 2^-carry_shift ticks make one), since prescalers differ:
+			int8_t	carry_shift;
+		};
+
+		/**
+		 * Duty scale factors (1/256 units) for each possible number of lit segments.
+		 */
+		struct DutyScales
+		{
+			uint16_t	scales[kSegmentsCount + 1];
+		};
+
+		/**
+		 * Timer0 setups for all modulation periods of a digit, longest first.
+		 */
+		struct PeriodTimings
+		{
+			PeriodTiming	periods[kModulationBits];
+		};
+
+		/**
+		 * Return true if all pins of the pinout are valid and distinct.
+		 */
+		static constexpr bool
+		pinout_valid();
+
+		/**
+		 * Return mask of all display pins on given port.
+		 */
+		static constexpr uint8_t
+		port_mask (DisplayPort);
+
+		/**
+		 * Return mask of digit-select pins on given port.
+		 */
+		static constexpr uint8_t
+		digit_mask (DisplayPort);
+
+		/**
+		 * Deselect all digits on given port, if it has any digit pins.
+		 */
+		template<DisplayPort Port>
+			static void
+			deselect_digits();
+
+		/**
+		 * Write segment bits of given image to given port, if the display uses it.
+		 */
+		template<DisplayPort Port>
+			static void
+			write_segments (DigitImage const&);
+
+		/**
+		 * Return PORTx register for given port.
+		 */
+		static uint8_t volatile&
+		port_register (DisplayPort);
+
+		/**
+		 * Return DDRx register for given port.
+		 */
+		static uint8_t volatile&
+		direction_register (DisplayPort);
+
+		/**
+		 * Return the smallest Timer0 prescaler value that can count given number of cycles,
+		 * or 0 if the period is too long for Timer0.
+		 */
+		static constexpr uint16_t
+		timer_prescaler (uint32_t cycles);
+
+		/**
+		 * Return log2 of given Timer0 prescaler value.
+		 */
+		static constexpr int8_t
+		prescaler_bits (uint16_t prescaler);
+
+		/**
+		 * Return Timer0 setup for a period of given number of cycles.
+		 * Doesn't set carry_shift.
+		 */
+		static constexpr PeriodTiming
+		period_timing (uint32_t cycles);
+
+		/**
+		 * Return Timer0 setups for all modulation periods for given unit length.
+		 */
+		static constexpr PeriodTimings
+		period_timings (uint32_t unit_cycles);
+
+		/**
+		 * Return Timer0 clock-select bits for given prescaler value.
+		 */
+		static constexpr uint8_t
+		timer_clock_select (uint16_t prescaler);
+
+		/**
+		 * Return current of each segment when given number of segments is lit.
+		 */
+		static constexpr uint32_t
+		segment_current_ua (uint8_t lit_segments);
+
+		/**
+		 * Compute duty scale factors from the current model and the budget.
+		 */
+		static constexpr DutyScales
+		duty_scales();
+
+	  private:
+		static DutyScales const		kDutyScales;
+		static BasicDisplay*		_scanned_display;
+
+		// Frames are triple-buffered: the interrupt switches to _frames[_front_frame] only between
+		// digits, so the frame it scans may lag behind _front_frame. publish() writes only to the
+		// frame that is neither of them:
+		Frame				_frames[3];
+		uint8_t volatile	_front_frame		= 0;
+		// Set only by the scanning interrupt:
+		uint8_t volatile	_scanned_frame		= 0;
+		PeriodTimings		_period_timings;
+		// Used only by the scanning interrupt:
+		uint8_t				_current_digit		= kDigitsCount - 1;
+		uint8_t				_current_period		= kModulationBits - 1;
+		uint8_t				_current_period_bit	= 1;
+#if DISPLAY_SCAN_PROFILING
+		uint16_t			_frame_cost_us		= 0;
+		ScanStatistics		_scan_statistics;
+#endif
 	};
 
-  public:
-	/**
-	 * Starts with disabled display.
-	 */
-	Display();
 
-	/**
-	 * Set display to defaults (display off, no blinking, etc).
-	 */
-	void
-	reset();
+template<uint8_t N, class P>
+	BasicDisplay<N, P>* BasicDisplay<N, P>::_scanned_display = nullptr;
 
-	/**
-	 * Enable/disable display.
-	 */
-	void
-	set_enabled (bool enabled);
 
-	/**
-	 * Set display digit to given value.
-	 */
-	void
-	set_digit (uint8_t digit, uint8_t value);
+template<uint8_t N, class P>
+	constexpr bool
+	BasicDisplay<N, P>::pinout_valid()
+	{
+		DisplayPin pins[kDigitsCount + kSegmentsCount] = { };
+		uint8_t count = 0;
 
-	/**
-	 * Set display digit to given value.
-	 */
-	void
-	set_digit (uint8_t digit, Sign);
+		for (auto const& pin: Pinout::kDigitPins)
+			pins[count++] = pin;
 
-	/**
-	 * Set all digits to given sign.
-	 */
-	template<class Value>
-		void
-		set_all_digits (Value);
+		for (auto const& pin: Pinout::kSegmentPins)
+			pins[count++] = pin;
 
-	/**
-	 * Set all digits to given value.
-	 */
-	template<class D1, class D2, class D3, class D4>
-		void
-		set_digits (D1, D2, D3, D4);
+		for (uint8_t i = 0; i < count; ++i)
+		{
+			if (pins[i].bit > 7)
+				return false;
 
-	/**
-	 * Enable/disable decimal point after given digit.
-	 */
-	void
-	set_dp (uint8_t digit, bool lit);
+			for (uint8_t j = i + 1; j < count; ++j)
+				if (pins[i].port == pins[j].port && pins[i].bit == pins[j].bit)
+					return false;
+		}
 
-	/**
-	 * Enable/disable all decimal points.
-	 */
-	void
-	set_all_dps (bool lit);
+		return true;
+	}
 
-	/**
-	 * Alias for set_dp (1, lit);
-	 */
-	void
-	set_colon (bool lit);
 
-	/**
-	 * Enable/disable given digit.
-	 */
-	void
-	set_digit_enabled (uint8_t digit, bool enabled);
+template<uint8_t N, class P>
+	constexpr uint8_t
+	BasicDisplay<N, P>::port_mask (DisplayPort port)
+	{
+		uint8_t mask = 0;
 
-	/**
-	 * Enable/disable all digits.
-	 */
-	void
-	set_all_digits_enabled (bool enabled);
+		for (auto const& pin: Pinout::kDigitPins)
+			if (pin.port == port)
+				mask |= 1 << pin.bit;
+
+		for (auto const& pin: Pinout::kSegmentPins)
+			if (pin.port == port)
+				mask |= 1 << pin.bit;
+
+		return mask;
+	}
+
+
+template<uint8_t N, class P>
+	constexpr uint8_t
+	BasicDisplay<N, P>::digit_mask (DisplayPort port)
+	{
+		uint8_t mask = 0;
+
+		for (auto const& pin: Pinout::kDigitPins)
+			if (pin.port == port)
+				mask |= 1 << pin.bit;
+
+		return mask;
+	}
+
+
+template<uint8_t N, class P>
+	BasicDisplay<N, P>::BasicDisplay()
+	{
+		static_assert (pinout_valid(), "pinout uses invalid or duplicate pins");
 
-	/**
-	 * Switch to displaying next digit on 7-segment displays.
-	 * Called in loop sweeps through all displays continuously.
-	 */
+		publish();
+
+		for (uint8_t p = 0; p < kPortsCount; ++p)
+		{
+			DisplayPort const port = static_cast<DisplayPort> (p);
+
+			if (port_mask (port))
+			{
+				port_register (port) &= ~port_mask (port);
+				direction_register (port) |= port_mask (port);
+			}
+		}
+	}
+
+
+template<uint8_t N, class P>
 	void
-	update();
-
-  private:
-	uint8_t	_current_digit		= 0;
-	uint8_t	_digits[4]			= { 0, 0, 0, 0 };
-	bool	_digit_enabled[4]	= { true, true, true, true };
-	bool	_dps_lit[4]			= { false, false, false, false };
-	bool	_enabled			= false;
-};
+	BasicDisplay<N, P>::publish()
+	{
+		// Interrupt may only switch _scanned_frame to _front_frame, which doesn't change here,
+		// so the frame picked here stays unused by the interrupt until it's published:
+		uint8_t const front = _front_frame;
+		uint8_t const scanned = _scanned_frame;
+		uint8_t const new_front = front == scanned
+			? (front == 2 ? 0 : front + 1)
+			: 3 - front - scanned;
+		Frame& frame = _frames[new_front];
+
+		for (uint8_t d = 0; d < kDigitsCount; ++d)
+		{
+			DigitImage& image = frame.digits[d];
+			uint8_t const symbol = Base::segments (_content, d);
+
+			for (auto& p: image.ports)
+				p = 0;
+
+			uint8_t lit_segments = 0;
+
+			for (uint8_t s = 0; s < kSegmentsCount; ++s)
+			{
+				if (get_bit (symbol, s))
+				{
+					image.ports[static_cast<uint8_t> (Pinout::kSegmentPins[s].port)] |= 1 << Pinout::kSegmentPins[s].bit;
+					++lit_segments;
+				}
+			}
+
+			image.select_port = static_cast<uint8_t> (Pinout::kDigitPins[d].port);
+			image.select_mask = 1 << Pinout::kDigitPins[d].bit;
+			image.duty = 0;
+
+			if (_content.enabled && lit_segments > 0)
+			{
+				uint8_t const duty = kGammaTable[_content.brightness] >> (kGammaBits - kModulationBits);
+				uint8_t const scaled_duty = (static_cast<uint16_t> (duty) * kDutyScales.scales[lit_segments]) >> 8;
+				// Don't let the lowest brightness levels go dark:
+				image.duty = _content.brightness > 0 && scaled_duty == 0 ? 1 : scaled_duty;
+			}
+		}
+
+		// Make sure the frame is complete before it's handed over to the interrupt:
+		asm volatile ("" ::: "memory");
+		// Single-byte store is atomic on AVR:
+		_front_frame = new_front;
+	}
 
 
-constexpr uint8_t Display::kDigitSymbols[];
+template<uint8_t N, class P>
+	template<uint16_t RefreshRateHz>
+		inline void
+		BasicDisplay<N, P>::start_scanning()
+		{
+			// Digit time slot is divided into 2^kModulationBits - 1 units:
+			constexpr uint32_t slot_cycles = F_CPU / (1UL * RefreshRateHz * kDigitsCount);
+			constexpr uint32_t unit_cycles = slot_cycles / ((1 << kModulationBits) - 1);
 
+			static_assert (unit_cycles >= kInterruptLatencyCycles + kMinPeriodCycles, "display refresh rate too high for brightness modulation");
+			static_assert (timer_prescaler (unit_cycles << (kModulationBits - 1)) != 0, "display refresh rate too low for Timer0");
 
-Display::Display()
-{
-	reset();
-
-	_digit1 = false;
-	_digit2 = false;
-	_digit3 = false;
-	_digit4 = false;
-	_segment_a = false;
-	_segment_b = false;
-	_segment_c = false;
-	_segment_d = false;
-	_segment_e = false;
-	_segment_f = false;
-	_segment_g = false;
-	_segment_dp = false;
-
-	_digit1.configure_as_output();
-	_digit2.configure_as_output();
-	_digit3.configure_as_output();
-	_digit4.configure_as_output();
-	_segment_a.configure_as_output();
-	_segment_b.configure_as_output();
-	_segment_c.configure_as_output();
-	_segment_d.configure_as_output();
-	_segment_e.configure_as_output();
-	_segment_f.configure_as_output();
-	_segment_g.configure_as_output();
-	_segment_dp.configure_as_output();
-}
+			constexpr PeriodTimings timings = period_timings (unit_cycles);
 
+			_period_timings = timings;
+			_scanned_display = this;
 
-inline void
-Display::reset()
-{
-	set_enabled (false);
-	set_all_digits (Sign::Empty);
-	set_all_dps (false);
-	_current_digit = 0;
+			// CTC mode, interrupt on compare match A. Start as if the last period of the last digit
+			// was being shown:
+			TCCR0A = 1 << WGM01;
+			TCCR0B = timings.periods[kModulationBits - 1].clock_select;
+			OCR0A = timings.periods[kModulationBits - 1].compare;
+			TCNT0 = 0;
+			TIMSK0 |= 1 << OCIE0A;
+		}
 
-	for (auto& e: _digit_enabled)
-		e = true;
-}
 
+template<uint8_t N, class P>
+	inline auto
+	BasicDisplay<N, P>::scan_statistics() const -> ScanStatistics
+	{
+		ScanStatistics result;
 
-inline void
-Display::set_enabled (bool enabled)
-{
-	_enabled = enabled;
-}
+#if DISPLAY_SCAN_PROFILING
+		ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+			result = _scan_statistics;
+#endif
 
+		return result;
+	}
 
-inline void
-Display::set_digit (uint8_t digit, uint8_t value)
-{
-	_digits[digit] = value;
-}
 
+template<uint8_t N, class P>
+	void
+	BasicDisplay<N, P>::update()
+	{
+#if DISPLAY_SCAN_PROFILING
+		// Timer1 counts microseconds (see SystemClock):
+		uint16_t const start_us = TCNT1;
+#endif
 
-inline void
-Display::set_digit (uint8_t digit, Sign sign)
-{
-	_digits[digit] = static_cast<uint8_t> (sign);
-}
+		bool const next_digit = ++_current_period == kModulationBits;
+
+		if (next_digit)
+		{
+			_current_period = 0;
+			_current_period_bit = 1 << (kModulationBits - 1);
 
+			if (++_current_digit >= kDigitsCount)
+			{
+				_current_digit = 0;
 
-template<class Value>
+#if DISPLAY_SCAN_PROFILING
+				_scan_statistics.last_frame_us = _frame_cost_us;
+
+				if (_frame_cost_us > _scan_statistics.max_frame_us)
+					_scan_statistics.max_frame_us = _frame_cost_us;
+
+				_frame_cost_us = 0;
+#endif
+			}
+
+			// Frame may only change between digits:
+			_scanned_frame = _front_frame;
+		}
+		else
+			_current_period_bit >>= 1;
+
+		// The new period started on compare match, so that interrupt latency doesn't add to it:
+		// reload the count with timer ticks elapsed since the match, converted to the new prescaler,
+		// and let it run up to the full period length. Count stays at OCR0A for one tick after the
+		// match before CTC clears it. Set up the timer before anything else, to keep the count
+		// well below the new compare value:
+		PeriodTiming const& timing = _period_timings.periods[_current_period];
+		uint8_t const count = TCNT0;
+		uint8_t const elapsed = count == OCR0A ? 0 : count + 1;
+		TCCR0B = timing.clock_select;
+		TCNT0 = timing.carry_shift >= 0 ? elapsed << timing.carry_shift : elapsed >> -timing.carry_shift;
+		OCR0A = timing.compare;
+
+		DigitImage const& image = _frames[_scanned_frame].digits[_current_digit];
+
+		if (next_digit)
+		{
+			// Digit pins are spread over several ports, so deselect all of them before touching
+			// any segments, then write segments (one read-modify-write per used port), and only
+			// then select the new digit. Otherwise the previous digit would briefly show
+			// segments of the new one:
+			deselect_digits<DisplayPort::B>();
+			deselect_digits<DisplayPort::C>();
+			deselect_digits<DisplayPort::D>();
+			deselect_digits<DisplayPort::E>();
+			deselect_digits<DisplayPort::F>();
+
+			write_segments<DisplayPort::B> (image);
+			write_segments<DisplayPort::C> (image);
+			write_segments<DisplayPort::D> (image);
+			write_segments<DisplayPort::E> (image);
+			write_segments<DisplayPort::F> (image);
+		}
+
+		uint8_t volatile& select_port = port_register (static_cast<DisplayPort> (image.select_port));
+
+		if (image.duty & _current_period_bit)
+			select_port |= image.select_mask;
+		else
+			select_port &= ~image.select_mask;
+
+#if DISPLAY_SCAN_PROFILING
+		_frame_cost_us += static_cast<uint16_t> (TCNT1 - start_us);
+#endif
+	}
+
+
+template<uint8_t N, class P>
 	inline void
-	Display::set_all_digits (Value value)
+	BasicDisplay<N, P>::handle_interrupt()
+	{
+		if (_scanned_display)
+			_scanned_display->update();
+	}
+
+
+template<uint8_t N, class P>
+	template<DisplayPort Port>
+		inline void
+		BasicDisplay<N, P>::deselect_digits()
+		{
+			constexpr uint8_t mask = digit_mask (Port);
+
+			// Compile-time constant, single cbi for ports with one digit pin:
+			if (mask)
+				port_register (Port) &= ~mask;
+		}
+
+
+template<uint8_t N, class P>
+	template<DisplayPort Port>
+		inline void
+		BasicDisplay<N, P>::write_segments (DigitImage const& image)
+		{
+			constexpr uint8_t mask = port_mask (Port);
+
+			// Compile-time constant, unused ports cost nothing:
+			if (mask)
+			{
+				uint8_t volatile& port = port_register (Port);
+				port = (port & ~mask) | image.ports[static_cast<uint8_t> (Port)];
+			}
+		}
+
+
+template<uint8_t N, class P>
+	constexpr uint16_t
+	BasicDisplay<N, P>::timer_prescaler (uint32_t cycles)
 	{
-		constexpr auto size = sizeof (_digits) / sizeof (_digits[0]);
+		constexpr uint16_t prescalers[] = { 1, 8, 64, 256, 1024 };
 
-		for (size_t i = 0; i < size; ++i)
-			set_digit (i, value);
+		for (auto p: prescalers)
+			if ((cycles + p / 2) / p <= 255)
+				return p;
+
+		return 0;
 	}
 
 
-template<class D1, class D2, class D3, class D4>
-	inline void
-	Display::set_digits (D1 d1, D2 d2, D3 d3, D4 d4)
+template<uint8_t N, class P>
+	constexpr auto
+	BasicDisplay<N, P>::period_timing (uint32_t cycles) -> PeriodTiming
 	{
-		set_digit (0, d1);
-		set_digit (1, d2);
-		set_digit (2, d3);
-		set_digit (3, d4);
+		uint16_t const prescaler = timer_prescaler (cycles);
+		uint16_t const ticks = (cycles - kCountReloadCycles + prescaler / 2) / prescaler;
+
+		return { timer_clock_select (prescaler), static_cast<uint8_t> (ticks < 2 ? 2 : ticks), 0 };
 	}
 
 
-inline void
-Display::set_dp (uint8_t digit, bool lit)
-{
-	_dps_lit[digit] = lit;
-}
+template<uint8_t N, class P>
+	constexpr int8_t
+	BasicDisplay<N, P>::prescaler_bits (uint16_t prescaler)
+	{
+		int8_t bits = 0;
 
+		while (prescaler > 1)
+		{
+			prescaler >>= 1;
+			++bits;
+		}
 
-void
-Display::set_all_dps (bool lit)
-{
-	constexpr auto size = sizeof (_dps_lit) / sizeof (_dps_lit[0]);
+		return bits;
+	}
 
-	for (size_t i = 0; i < size; ++i)
-		set_dp (i, lit);
-}
 
+template<uint8_t N, class P>
+	constexpr uint32_t
+	BasicDisplay<N, P>::segment_current_ua (uint8_t lit_segments)
+	{
+		return kSegmentCurrentUA * 1000 / (1000 + kSegmentDroopPermille * (lit_segments - 1));
+	}
 
-inline void
-Display::set_colon (bool lit)
-{
-	set_dp (1, lit);
-}
 
+template<uint8_t N, class P>
+	constexpr auto
+	BasicDisplay<N, P>::duty_scales() -> DutyScales
+	{
+		DutyScales result {};
+		// Common factor (1/256 units) applied to all scales to fit within the pin current budget:
+		uint32_t budget_factor = 256;
 
-inline void
-Display::set_digit_enabled (uint8_t digit, bool enabled)
-{
-	_digit_enabled[digit] = enabled;
-}
+		for (uint8_t n = 1; n <= kSegmentsCount; ++n)
+		{
+			// Segment current is inversely proportional to this, so is the duty needed
+			// for equal brightness. Normalized so that all segments lit gives 256:
+			result.scales[n] = 256 * (1000 + kSegmentDroopPermille * (n - 1)) / (1000 + kSegmentDroopPermille * (kSegmentsCount - 1));
 
+			// Average pin current at full duty: pin is active during 1 / kDigitsCount of time:
+			uint32_t const full_duty_current = n * segment_current_ua (n) * result.scales[n] / 256 / kDigitsCount;
+			uint32_t const factor = 256 * kPinCurrentBudgetUA / full_duty_current;
 
-void
-Display::set_all_digits_enabled (bool enabled)
-{
-	constexpr auto size = sizeof (_digits) / sizeof (_digits[0]);
+			if (factor < budget_factor)
+				budget_factor = factor;
+		}
 
-	for (size_t i = 0; i < size; ++i)
-		_digit_enabled[i] = enabled;
-}
+		for (auto& scale: result.scales)
+			scale = scale * budget_factor / 256;
+
+		return result;
+	}
 
 
-void
-Display::update()
-{
-	_current_digit++;
+template<uint8_t N, class P>
+	constexpr typename BasicDisplay<N, P>::DutyScales BasicDisplay<N, P>::kDutyScales = BasicDisplay<N, P>::duty_scales();
 
-	if (_current_digit > 4)
-		_current_digit = 0;
 
-	uint8_t const symbol = kDigitSymbols[_digits[_current_digit]];
-	uint8_t const digit_bit = _enabled
-		? (1 << _current_digit)
-		: 0;
+template<uint8_t N, class P>
+	constexpr auto
+	BasicDisplay<N, P>::period_timings (uint32_t unit_cycles) -> PeriodTimings
+	{
+		PeriodTimings result {};
 
-	_digit1 = false;
-	_digit2 = false;
-	_digit3 = false;
-	_digit4 = false;
+		for (uint8_t i = 0; i < kModulationBits; ++i)
+		{
+			// The first period follows the last one of the previous digit:
+			uint8_t const previous = i == 0 ? kModulationBits - 1 : i - 1;
 
-	auto const current_enabled = _digit_enabled[_current_digit];
+			result.periods[i] = period_timing (unit_cycles << (kModulationBits - 1 - i));
+			result.periods[i].carry_shift = prescaler_bits (timer_prescaler (unit_cycles << (kModulationBits - 1 - previous)))
+										  - prescaler_bits (timer_prescaler (unit_cycles << (kModulationBits - 1 - i)));
+		}
 
-	_segment_a = get_bit (symbol, 0) && current_enabled;
-	_segment_b = get_bit (symbol, 1) && current_enabled;
-	_segment_c = get_bit (symbol, 2) && current_enabled;
-	_segment_d = get_bit (symbol, 3) && current_enabled;
-	_segment_e = get_bit (symbol, 4) && current_enabled;
-	_segment_f = get_bit (symbol, 5) && current_enabled;
-	_segment_g = get_bit (symbol, 6) && current_enabled;
+		return result;
+	}
 
-	_segment_dp = _dps_lit[_current_digit];
 
-	_digit1 = get_bit (digit_bit, 0);
-	_digit2 = get_bit (digit_bit, 1);
-	_digit3 = get_bit (digit_bit, 2);
-	_digit4 = get_bit (digit_bit, 3);
+template<uint8_t N, class P>
+	constexpr uint8_t
+	BasicDisplay<N, P>::timer_clock_select (uint16_t prescaler)
+	{
+		switch (prescaler)
+		{
+			case 1:		return 0b001;
+			case 8:		return 0b010;
+			case 64:	return 0b011;
+			case 256:	return 0b100;
+			default:	return 0b101;
+		}
+	}
+
+
+template<uint8_t N, class P>
+	inline uint8_t volatile&
+	BasicDisplay<N, P>::port_register (DisplayPort port)
+	{
+		switch (port)
+		{
+			case DisplayPort::B:	return PORTB;
+			case DisplayPort::C:	return PORTC;
+			case DisplayPort::D:	return PORTD;
+			case DisplayPort::E:	return PORTE;
+			default:				return PORTF;
+		}
+	}
+
+
+template<uint8_t N, class P>
+	inline uint8_t volatile&
+	BasicDisplay<N, P>::direction_register (DisplayPort port)
+	{
+		switch (port)
+		{
+			case DisplayPort::B:	return DDRB;
+			case DisplayPort::C:	return DDRC;
+			case DisplayPort::D:	return DDRD;
+			case DisplayPort::E:	return DDRE;
+			default:				return DDRF;
+		}
+	}
+
+
+#if !DISPLAY_SHIFT_REGISTER
+
+using Display = BasicDisplay<4, Clock1337Pinout>;
+
+
+ISR (TIMER0_COMPA_vect)
+{
+	Display::handle_interrupt();
 }
 
 #endif
 
+#endif
+
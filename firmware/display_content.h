@@ -0,0 +1,340 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__DISPLAY_CONTENT__INCLUDED
+#define CLOCK_1337__DISPLAY_CONTENT__INCLUDED
+
+/**
+ * What's shown on a 7-segment display, independent of how it's driven.
+ * Display backends derive from it, provide publish() and turn the content
+ * into whatever their hardware needs.
+ */
+template<uint8_t pDigitsCount>
+	class BasicDisplayContent
+	{
+	  public:
+		static constexpr uint8_t	kDigitsCount		{ pDigitsCount };
+
+		// Segments a…g, then dp:
+		static constexpr uint8_t	kSegmentsCount		{ 8 };
+
+		// Number of levels accepted by set_brightness():
+		static constexpr uint8_t	kBrightnessLevels	{ 16 };
+
+		static_assert (kDigitsCount > 0, "display needs at least one digit");
+
+		// Special characters to be displayed, glyphs come from the font:
+		enum class Sign: uint8_t
+		{
+			Minus	= '-',
+			Empty	= ' ',
+			S		= 'S',
+			E		= 'E',
+			T		= 'T',
+			N		= 'N',
+			O		= 'O',
+			R		= 'R',
+			L		= 'L',
+			D		= 'D',
+			P		= 'P',
+			B		= 'B',
+			F		= 'F',
+		};
+
+	  protected:
+		// Duty values for brightness levels, 6-bit, gamma 2.2 (made strictly increasing
+		// at the low end):
+		static constexpr uint8_t	kGammaBits			{ 6 };
+
+		static constexpr uint8_t kGammaTable[kBrightnessLevels] = {
+			0, 1, 2, 3, 4, 6, 8, 12, 16, 20, 26, 32, 39, 46, 54, 63,
+		};
+
+		static_assert (kGammaTable[kBrightnessLevels - 1] == (1 << kGammaBits) - 1, "gamma table doesn't match its bits");
+
+		/**
+		 * What's set with set_*() methods.
+		 */
+		struct Content
+		{
+			// Segment bits of each digit, dp included:
+			uint8_t	segments[kDigitsCount]		= { };
+			bool	digit_enabled[kDigitsCount]	= { };
+			bool	enabled						= false;
+			uint8_t	brightness					= kBrightnessLevels - 1;
+		};
+
+	  public:
+		/**
+		 * Starts with disabled display.
+		 */
+		BasicDisplayContent();
+
+		/**
+		 * Set display to defaults (display off, no blinking, etc).
+		 */
+		void
+		reset();
+
+		/**
+		 * Enable/disable display.
+		 */
+		void
+		set_enabled (bool enabled);
+
+		/**
+		 * Set display digit to given value.
+		 */
+		void
+		set_digit (uint8_t digit, uint8_t value);
+
+		/**
+		 * Set display digit to given value.
+		 */
+		void
+		set_digit (uint8_t digit, Sign);
+
+		/**
+		 * Set segments of given digit directly (a…g from bit 0, bit 7 is dp).
+		 */
+		void
+		set_segments (uint8_t digit, uint8_t segments);
+
+		/**
+		 * Show flash-resident text (see font::render()) with given character
+		 * on the leftmost digit. Digits outside of the text are blank.
+		 * Dps are taken from the text.
+		 */
+		template<uint8_t Length>
+			void
+			set_text (font::Text<Length> const& text_in_flash, int8_t offset = 0);
+
+		/**
+		 * Set all digits to given sign.
+		 */
+		template<class Value>
+			void
+			set_all_digits (Value);
+
+		/**
+		 * Set all digits to given values (digits or signs), left to right.
+		 */
+		template<class ...Values>
+			void
+			set_digits (Values...);
+
+		/**
+		 * Enable/disable decimal point after given digit.
+		 */
+		void
+		set_dp (uint8_t digit, bool lit);
+
+		/**
+		 * Enable/disable all decimal points.
+		 */
+		void
+		set_all_dps (bool lit);
+
+		/**
+		 * Alias for set_dp (1, lit);
+		 */
+		void
+		set_colon (bool lit);
+
+		/**
+		 * Enable/disable given digit.
+		 */
+		void
+		set_digit_enabled (uint8_t digit, bool enabled);
+
+		/**
+		 * Enable/disable all digits.
+		 */
+		void
+		set_all_digits_enabled (bool enabled);
+
+		/**
+		 * Set brightness level, 0…kBrightnessLevels - 1.
+		 * Levels are gamma-corrected, so they appear evenly spaced.
+		 */
+		void
+		set_brightness (uint8_t level);
+
+	  protected:
+		/**
+		 * Return segment bits to be lit for given digit.
+		 * Doesn't take enabled flag of the whole display into account.
+		 */
+		static constexpr uint8_t
+		segments (Content const&, uint8_t digit);
+
+	  protected:
+		Content	_content;
+	};
+
+
+template<uint8_t N>
+	constexpr uint8_t BasicDisplayContent<N>::kGammaTable[];
+
+
+template<uint8_t N>
+	inline
+	BasicDisplayContent<N>::BasicDisplayContent()
+	{
+		reset();
+	}
+
+
+template<uint8_t N>
+	inline void
+	BasicDisplayContent<N>::reset()
+	{
+		set_enabled (false);
+		set_all_digits (Sign::Empty);
+		set_all_dps (false);
+		set_all_digits_enabled (true);
+	}
+
+
+template<uint8_t N>
+	inline void
+	BasicDisplayContent<N>::set_enabled (bool enabled)
+	{
+		_content.enabled = enabled;
+	}
+
+
+template<uint8_t N>
+	inline void
+	BasicDisplayContent<N>::set_digit (uint8_t digit, uint8_t value)
+	{
+		set_segments (digit, font::read_glyph ('0' + value) | (_content.segments[digit] & font::kDotBit));
+	}
+
+
+template<uint8_t N>
+	inline void
+	BasicDisplayContent<N>::set_digit (uint8_t digit, Sign sign)
+	{
+		set_segments (digit, font::read_glyph (static_cast<char> (sign)) | (_content.segments[digit] & font::kDotBit));
+	}
+
+
+template<uint8_t N>
+	inline void
+	BasicDisplayContent<N>::set_segments (uint8_t digit, uint8_t segments)
+	{
+		_content.segments[digit] = segments;
+	}
+
+
+template<uint8_t N>
+	template<uint8_t Length>
+		inline void
+		BasicDisplayContent<N>::set_text (font::Text<Length> const& text_in_flash, int8_t offset)
+		{
+			for (uint8_t i = 0; i < kDigitsCount; ++i)
+			{
+				int8_t const c = offset + i;
+				set_segments (i, c >= 0 && c < Length ? pgm_read_byte (&text_in_flash.segments[c]) : 0);
+			}
+		}
+
+
+template<uint8_t N>
+	template<class Value>
+		inline void
+		BasicDisplayContent<N>::set_all_digits (Value value)
+		{
+			for (uint8_t i = 0; i < kDigitsCount; ++i)
+				set_digit (i, value);
+		}
+
+
+template<uint8_t N>
+	template<class ...Values>
+		inline void
+		BasicDisplayContent<N>::set_digits (Values ...values)
+		{
+			static_assert (sizeof... (Values) == kDigitsCount, "number of values must match number of digits");
+
+			uint8_t digit = 0;
+			// Elements of braced initializer are evaluated in order:
+			bool const sequence[] = { (set_digit (digit++, values), true)... };
+			static_cast<void> (sequence);
+		}
+
+
+template<uint8_t N>
+	inline void
+	BasicDisplayContent<N>::set_dp (uint8_t digit, bool lit)
+	{
+		if (lit)
+			_content.segments[digit] |= font::kDotBit;
+		else
+			_content.segments[digit] &= ~font::kDotBit;
+	}
+
+
+template<uint8_t N>
+	void
+	BasicDisplayContent<N>::set_all_dps (bool lit)
+	{
+		for (uint8_t i = 0; i < kDigitsCount; ++i)
+			set_dp (i, lit);
+	}
+
+
+template<uint8_t N>
+	inline void
+	BasicDisplayContent<N>::set_colon (bool lit)
+	{
+		set_dp (1, lit);
+	}
+
+
+template<uint8_t N>
+	inline void
+	BasicDisplayContent<N>::set_digit_enabled (uint8_t digit, bool enabled)
+	{
+		_content.digit_enabled[digit] = enabled;
+	}
+
+
+template<uint8_t N>
+	void
+	BasicDisplayContent<N>::set_all_digits_enabled (bool enabled)
+	{
+		for (uint8_t i = 0; i < kDigitsCount; ++i)
+			set_digit_enabled (i, enabled);
+	}
+
+
+template<uint8_t N>
+	inline void
+	BasicDisplayContent<N>::set_brightness (uint8_t level)
+	{
+		_content.brightness = level < kBrightnessLevels ? level : kBrightnessLevels - 1;
+	}
+
+
+template<uint8_t N>
+	constexpr uint8_t
+	BasicDisplayContent<N>::segments (Content const& content, uint8_t digit)
+	{
+		// Dps stay lit on disabled digits:
+		return content.segments[digit] & (content.digit_enabled[digit] ? 0xff : font::kDotBit);
+	}
+
+#endif
+
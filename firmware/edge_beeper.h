@@ -0,0 +1,159 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__EDGE_BEEPER__INCLUDED
+#define CLOCK_1337__EDGE_BEEPER__INCLUDED
+
+// System:
+#include <util/atomic.h>
+
+
+/**
+ * Starts Buzzer patterns at a given SystemClock time, typically a predicted
+ * second edge (see TimeKeeper::next_edge_us()), so beeps don't wait for
+ * the main loop to notice that the second has changed.
+ *
+ * Uses Timer1 compare-match B. Compare register holds only the lower 16 bits
+ * of the deadline, so the interrupt fires every ~65 ms until the full
+ * timestamp is reached; that's a few cheap interrupts per scheduled beep.
+ * Start time of each beep is recorded, to be compared with the RTC edge.
+ */
+class EdgeBeeper
+{
+	// Deadlines closer than this may be missed by the compare unit, so they're handled right away:
+	static constexpr int32_t	kMinLeadUs		{ 16 };
+
+  public:
+	/**
+	 * Start playing given pattern from flash at given time.
+	 * Replaces previously scheduled pattern, if it hasn't started yet.
+	 * Deadline must be less than ~30 minutes ahead.
+	 */
+	static void
+	schedule (uint32_t at_us, Buzzer::Note const* pattern_in_flash);
+
+	/**
+	 * Cancel scheduled pattern, if any.
+	 */
+	static void
+	cancel();
+
+	/**
+	 * Return time at which a scheduled pattern has started since the last call.
+	 * Return false if none has.
+	 */
+	static bool
+	take_started (uint32_t& started_us);
+
+	/**
+	 * Timer1 compare-match B interrupt handler.
+	 */
+	static void
+	handle_timer_interrupt();
+
+  private:
+	/**
+	 * Start the pattern now. Call with interrupts disabled.
+	 */
+	static void
+	start (uint32_t now_us);
+
+  private:
+	// Used only with interrupts disabled:
+	static uint32_t				_at_us;
+	static Buzzer::Note const*	_pattern;
+	static uint32_t				_started_us;
+	static bool					_started;
+};
+
+
+uint32_t EdgeBeeper::_at_us = 0;
+Buzzer::Note const* EdgeBeeper::_pattern = nullptr;
+uint32_t EdgeBeeper::_started_us = 0;
+bool EdgeBeeper::_started = false;
+
+
+ISR (TIMER1_COMPB_vect)
+{
+	EdgeBeeper::handle_timer_interrupt();
+}
+
+
+inline void
+EdgeBeeper::schedule (uint32_t at_us, Buzzer::Note const* pattern_in_flash)
+{
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		_at_us = at_us;
+		_pattern = pattern_in_flash;
+
+		uint32_t const now_us = SystemClock::timestamp (TCNT1);
+
+		if (static_cast<int32_t> (at_us - now_us) < kMinLeadUs)
+			start (now_us);
+		else
+		{
+			OCR1B = at_us;
+			TIFR1 = 1 << OCF1B;
+			TIMSK1 |= 1 << OCIE1B;
+		}
+	}
+}
+
+
+inline void
+EdgeBeeper::cancel()
+{
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		TIMSK1 &= ~(1 << OCIE1B);
+}
+
+
+inline bool
+EdgeBeeper::take_started (uint32_t& started_us)
+{
+	bool result = false;
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+	{
+		result = _started;
+		started_us = _started_us;
+		_started = false;
+	}
+
+	return result;
+}
+
+
+inline void
+EdgeBeeper::handle_timer_interrupt()
+{
+	uint32_t const now_us = SystemClock::timestamp (TCNT1);
+
+	// Lower 16 bits match every ~65 ms, deadline may still be ahead:
+	if (static_cast<int32_t> (now_us - _at_us) >= 0)
+		start (now_us);
+}
+
+
+inline void
+EdgeBeeper::start (uint32_t now_us)
+{
+	TIMSK1 &= ~(1 << OCIE1B);
+	Buzzer::play (_pattern);
+	_started_us = now_us;
+	_started = true;
+}
+
+#endif
+
@@ -0,0 +1,109 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__FIXED_POINT__INCLUDED
+#define CLOCK_1337__FIXED_POINT__INCLUDED
+
+/**
+ * Fixed-point helpers that replace runtime division with multiplications
+ * and shifts. AVR has no hardware divider and 32-bit division routines
+ * are slow and big, so firmware code shouldn't divide at runtime
+ * (the build checks that no division or float routines get linked in).
+ */
+namespace fixed_point {
+
+/**
+ * Return floor (log2 (value)) for value > 0.
+ */
+constexpr uint8_t
+log2 (uint32_t value)
+{
+	uint8_t result = 0;
+
+	while (value >>= 1)
+		++result;
+
+	return result;
+}
+
+
+/**
+ * Return 2^fraction_bits / divisor, rounded.
+ * Meant for compile-time use only.
+ */
+constexpr uint64_t
+reciprocal (uint32_t divisor, uint8_t fraction_bits)
+{
+	return ((static_cast<uint64_t> (1) << fraction_bits) + divisor / 2) / divisor;
+}
+
+
+/**
+ * Return the largest number of fraction bits for which
+ * max_value * reciprocal (divisor, bits) still fits in int32_t.
+ * Meant for compile-time use only.
+ */
+constexpr uint8_t
+reciprocal_bits (uint32_t divisor, uint32_t max_value)
+{
+	uint8_t bits = 0;
+
+	while (bits < 62 && max_value * reciprocal (divisor, bits + 1) <= 0x7fffffff)
+		++bits;
+
+	return bits;
+}
+
+
+/**
+ * Compute value * 2^ResultFractionBits / Divisor using multiplication by
+ * a compile-time reciprocal of Divisor. MaxValue is the largest absolute value
+ * that will be passed; the most precise reciprocal that doesn't overflow
+ * 32-bit product is used. Result is rounded towards negative infinity.
+ */
+template<uint32_t Divisor, uint32_t MaxValue, uint8_t ResultFractionBits = 0>
+	constexpr int32_t
+	divide (int32_t value)
+	{
+		static_assert (Divisor > 0, "division by zero");
+
+		constexpr uint8_t kBits = reciprocal_bits (Divisor, MaxValue);
+		constexpr int32_t kReciprocal = reciprocal (Divisor, kBits);
+
+		static_assert (kBits >= ResultFractionBits, "MaxValue is too large for 32-bit reciprocal multiplication");
+
+		return (value * kReciprocal) >> (kBits - ResultFractionBits);
+	}
+
+
+/**
+ * Shift right by given number of bits, rounding to nearest
+ * (half away from zero) instead of towards negative infinity.
+ */
+constexpr int32_t
+shift_right_rounded (int32_t value, uint8_t bits)
+{
+	if (bits == 0)
+		return value;
+
+	int32_t const half = static_cast<int32_t> (1) << (bits - 1);
+
+	return value >= 0
+		? (value + half) >> bits
+		: -((-value + half) >> bits);
+}
+
+} // namespace fixed_point
+
+#endif
+
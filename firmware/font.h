@@ -0,0 +1,175 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__FONT__INCLUDED
+#define CLOCK_1337__FONT__INCLUDED
+
+// System:
+#include <avr/pgmspace.h>
+
+
+/**
+ * 7-segment font. Glyphs are segment bits a…g from bit 0, bit 7 is dp.
+ * The glyph table lives in flash. Texts are converted to segments at compile
+ * time with render() and should be stored in flash too (PROGMEM), then shown
+ * with Display::set_text().
+ */
+namespace font {
+
+// First character in kGlyphs:
+constexpr char		kFirstChar	{ ' ' };
+// Segment bit of the decimal point:
+constexpr uint8_t	kDotBit		{ 1 << 7 };
+
+// Characters ' '…'_'; lowercase letters use uppercase glyphs, anything
+// that can't be shown is blank:
+constexpr uint8_t kGlyphs[] PROGMEM = {
+	0x00, // ' ' |       |
+	0x86, // !   | bc   .|
+	0x22, // "   | b   f |
+	0x00, // #
+	0x6d, // $   |a cd fg|
+	0x00, // %
+	0x00, // &
+	0x02, // '   | b     |
+	0x39, // (   |a  def |
+	0x0f, // )   |abcd   |
+	0x00, // *
+	0x00, // +
+	0x80, // ,   |      .|
+	0x40, // -   |      g|
+	0x80, // .   |      .|
+	0x52, // /   | b  e g|
+	0x3f, // 0   |abcdef |
+	0x06, // 1   | bc    |
+	0x5b, // 2   |ab de g|
+	0x4f, // 3   |abcd  g|
+	0x66, // 4   | bc  fg|
+	0x6d, // 5   |a cd fg|
+	0x7d, // 6   |a cdefg|
+	0x07, // 7   |abc    |
+	0x7f, // 8   |abcdefg|
+	0x6f, // 9   |abcd fg|
+	0x00, // :
+	0x00, // ;
+	0x00, // <
+	0x48, // =   |   d  g|
+	0x00, // >
+	0x53, // ?   |ab  e g|
+	0x5f, // @   |abcde g|
+	0x77, // A   |abc efg|
+	0x7c, // B   |  cdefg|
+	0x39, // C   |a  def |
+	0x5e, // D   | bcde g|
+	0x79, // E   |a  defg|
+	0x71, // F   |a   efg|
+	0x3d, // G   |a cdef |
+	0x76, // H   | bc efg|
+	0x30, // I   |    ef |
+	0x1e, // J   | bcde  |
+	0x75, // K   |a c efg|
+	0x38, // L   |   def |
+	0x37, // M   |abc ef |
+	0x54, // N   |  c e g|
+	0x5c, // O   |  cde g|
+	0x73, // P   |ab  efg|
+	0x67, // Q   |abc  fg|
+	0x50, // R   |    e g|
+	0x6d, // S   |a cd fg|
+	0x78, // T   |   defg|
+	0x3e, // U   | bcdef |
+	0x1c, // V   |  cde  |
+	0x2a, // W   | b d f |
+	0x76, // X   | bc efg|
+	0x6e, // Y   | bcd fg|
+	0x5b, // Z   |ab de g|
+	0x39, // [   |a  def |
+	0x64, // \   |  c  fg|
+	0x0f, // ]   |abcd   |
+	0x23, // ^   |ab   f |
+	0x08, // _   |   d   |
+};
+
+
+/**
+ * Text converted to segments, one byte per display digit.
+ */
+template<uint8_t pLength>
+	struct Text
+	{
+		static constexpr uint8_t kLength { pLength };
+
+		uint8_t	segments[pLength];
+	};
+
+
+/**
+ * Return index of given character in kGlyphs, or kGlyphs size if there's no glyph for it.
+ */
+constexpr uint8_t
+glyph_index (char c)
+{
+	return c >= 'a' && c <= 'z'
+		? c - 'a' + 'A' - kFirstChar
+		: c >= kFirstChar && static_cast<uint8_t> (c - kFirstChar) < sizeof (kGlyphs)
+			? c - kFirstChar
+			: sizeof (kGlyphs);
+}
+
+
+/**
+ * Return glyph for given character. Compile-time only, at runtime
+ * kGlyphs must be read from flash, use read_glyph().
+ */
+constexpr uint8_t
+glyph (char c)
+{
+	return glyph_index (c) < sizeof (kGlyphs) ? kGlyphs[glyph_index (c)] : 0;
+}
+
+
+/**
+ * Read glyph for given character from flash.
+ */
+inline uint8_t
+read_glyph (char c)
+{
+	uint8_t const index = glyph_index (c);
+
+	return index < sizeof (kGlyphs) ? pgm_read_byte (&kGlyphs[index]) : 0;
+}
+
+
+/**
+ * Convert string literal to segments.
+ */
+template<size_t N>
+	constexpr Text<N - 1>
+	render (char const (&string)[N])
+	{
+		Text<N - 1> result {};
+
+		for (size_t i = 0; i < N - 1; ++i)
+			result.segments[i] = glyph (string[i]);
+
+		return result;
+	}
+
+
+static_assert (sizeof (kGlyphs) == '_' - kFirstChar + 1, "font must cover ' '…'_'");
+static_assert (glyph ('8') == 0x7f && glyph ('l') == glyph ('L') && glyph ('~') == 0, "font lookup is broken");
+
+} // namespace font
+
+#endif
+
@@ -0,0 +1,217 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__GESTURE_RECOGNIZER__INCLUDED
+#define CLOCK_1337__GESTURE_RECOGNIZER__INCLUDED
+
+/**
+ * Turns debounced, timestamped button edges into gestures.
+ *
+ * Press level is 1 right after the press and grows by 1 every threshold
+ * time. Gestures:
+ *   • LongPress (level N ≥ 2): button is still held and has just reached level N,
+ *   • Click (level 1): released at level 1,
+ *   • Release (level N ≥ 2): released at level N,
+ *   • DoubleClick (level 2): second click that started within double-click
+ *     time from the previous click release. Comes right after that second
+ *     Click; clicks are never delayed to wait for a possible double-click.
+ *
+ * Levels are computed from edge timestamps. tick() only needs to be called
+ * often enough for LongPress gestures to be timely, and only while
+ * needs_ticks() returns true.
+ */
+class GestureRecognizer
+{
+  public:
+	enum class Type: uint8_t
+	{
+		Click,
+		DoubleClick,
+		LongPress,
+		Release,
+	};
+
+	struct Gesture
+	{
+		Type	type;
+		uint8_t	level;
+
+		constexpr bool
+		operator== (Gesture const& other) const
+		{
+			return type == other.type && level == other.level;
+		}
+	};
+
+	/**
+	 * Gestures recognized by a single call.
+	 */
+	struct Gestures
+	{
+		Gesture	list[2]	= { };
+		uint8_t	count	= 0;
+
+		constexpr void
+		add (Type type, uint8_t level)
+		{
+			list[count++] = { type, level };
+		}
+	};
+
+  public:
+	// Ctor
+	constexpr
+	GestureRecognizer (uint16_t threshold_ms, uint16_t double_click_ms);
+
+	/**
+	 * Handle button press that happened at given time.
+	 */
+	constexpr Gestures
+	press (uint32_t time_us);
+
+	/**
+	 * Handle button release that happened at given time.
+	 */
+	constexpr Gestures
+	release (uint32_t time_us);
+
+	/**
+	 * Update press level for current time.
+	 */
+	constexpr Gestures
+	tick (uint32_t now_us);
+
+	/**
+	 * Return true if tick() needs to be called.
+	 */
+	constexpr bool
+	needs_ticks() const;
+
+  private:
+	/**
+	 * Count threshold periods of the current press that have passed until given time.
+	 */
+	constexpr void
+	count_levels (uint32_t now_us);
+
+  private:
+	uint32_t	_threshold_us;
+	uint32_t	_double_click_us;
+	bool		_pressed				= false;
+	// Level of the current press and start of its current threshold period:
+	uint8_t		_level					= 0;
+	uint32_t	_level_start_us			= 0;
+	// Highest level reported with LongPress:
+	uint8_t		_reported_level			= 0;
+	// Release time of the last click, if it can still become a double-click:
+	bool		_click_pending			= false;
+	uint32_t	_click_time_us			= 0;
+	// Current press started within double-click time from the last click:
+	bool		_double_click_candidate	= false;
+};
+
+
+constexpr
+GestureRecognizer::GestureRecognizer (uint16_t threshold_ms, uint16_t double_click_ms):
+	_threshold_us (threshold_ms * 1000UL),
+	_double_click_us (double_click_ms * 1000UL)
+{ }
+
+
+constexpr auto
+GestureRecognizer::press (uint32_t time_us) -> Gestures
+{
+	_double_click_candidate = _click_pending && time_us - _click_time_us < _double_click_us;
+	_click_pending = false;
+	_pressed = true;
+	_level = 1;
+	_reported_level = 1;
+	_level_start_us = time_us;
+
+	return { };
+}
+
+
+constexpr auto
+GestureRecognizer::release (uint32_t time_us) -> Gestures
+{
+	Gestures result;
+
+	if (!_pressed)
+		return result;
+
+	// Periods completed before the release count even if ticks were late:
+	count_levels (time_us);
+	_pressed = false;
+
+	if (_level == 1)
+	{
+		result.add (Type::Click, 1);
+
+		if (_double_click_candidate)
+			result.add (Type::DoubleClick, 2);
+
+		// Third click starts counting anew:
+		_click_pending = !_double_click_candidate;
+		_click_time_us = time_us;
+	}
+	else
+		result.add (Type::Release, _level);
+
+	_double_click_candidate = false;
+
+	return result;
+}
+
+
+constexpr auto
+GestureRecognizer::tick (uint32_t now_us) -> Gestures
+{
+	Gestures result;
+
+	if (_pressed)
+	{
+		count_levels (now_us);
+
+		// One level per tick, if ticks were late the rest comes with the next ones:
+		if (_level > _reported_level)
+			result.add (Type::LongPress, ++_reported_level);
+	}
+	else if (_click_pending && now_us - _click_time_us >= _double_click_us)
+		_click_pending = false;
+
+	return result;
+}
+
+
+constexpr bool
+GestureRecognizer::needs_ticks() const
+{
+	return _pressed || _click_pending;
+}
+
+
+constexpr void
+GestureRecognizer::count_levels (uint32_t now_us)
+{
+	while (now_us - _level_start_us >= _threshold_us)
+	{
+		if (_level < 0xff)
+			_level++;
+
+		_level_start_us += _threshold_us;
+	}
+}
+
+#endif
+
@@ -0,0 +1,44 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__HOST__AVR__PGMSPACE__INCLUDED
+#define CLOCK_1337__HOST__AVR__PGMSPACE__INCLUDED
+
+/*
+ * Host replacement for avr-libc <avr/pgmspace.h>: there's a single
+ * address space, so flash data is read like any other.
+ */
+
+// Standard:
+#include <cstdint>
+#include <cstring>
+
+
+#define PROGMEM
+
+
+inline uint8_t
+pgm_read_byte (void const* address)
+{
+	return *static_cast<uint8_t const*> (address);
+}
+
+
+inline void*
+memcpy_P (void* destination, void const* source, size_t size)
+{
+	return std::memcpy (destination, source, size);
+}
+
+#endif
+
@@ -0,0 +1,104 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+/**
+ * Compares Countdown with the reference 32-bit formula over whole days,
+ * both when decremented and when recomputed from scratch.
+ */
+
+#include "host.h"
+
+// Local:
+#include "bcd.h"
+#include "time.h"
+#include "countdown.h"
+
+
+namespace {
+
+bool
+matches (Countdown const& countdown, int32_t left_secs)
+{
+	Time const& left = countdown.left();
+
+	return left.valid() &&
+		   bcd::to_binary (left.hours) == left_secs / 3600L &&
+		   bcd::to_binary (left.minutes) == (left_secs / 60L) % 60L &&
+		   bcd::to_binary (left.seconds) == left_secs % 60L &&
+		   countdown.less_than_minutes (10) == (left_secs < 10 * 60) &&
+		   (!countdown.less_than_minutes (18) || countdown.left_seconds() == left_secs);
+}
+
+
+/**
+ * Run countdown to given target for a full day, starting at given time.
+ * Every step_every seconds time jumps by an extra second, so that update()
+ * has to recompute instead of decrementing.
+ */
+void
+test_day (Time const& target, Time const& from, uint16_t step_every)
+{
+	Countdown countdown (target);
+	Time now = from;
+	uint32_t errors = 0;
+
+	countdown.update (now);
+
+	for (uint32_t i = 0; i < 86400; ++i)
+	{
+		// Check BCD time increments too:
+		if (!now.valid() || now.seconds_since_midnight() != (from.seconds_since_midnight() + i) % 86400L)
+			errors++;
+
+		int32_t const diff = static_cast<int32_t> (target.seconds_since_midnight()) - static_cast<int32_t> (now.seconds_since_midnight());
+		int32_t const left_secs = (diff + 86400L - 1) % 86400L;
+
+		Countdown fresh (target);
+		fresh.reset (now);
+
+		if (!matches (countdown, left_secs) || !matches (fresh, left_secs))
+			errors++;
+
+		now.increment_seconds();
+
+		if (step_every && i % step_every == step_every - 1U)
+		{
+			now.increment_seconds();
+			++i;
+		}
+
+		countdown.update (now);
+	}
+
+	std::printf ("target %02x:%02x:%02x from %02x:%02x:%02x%s: %lu mismatches\n",
+				 target.hours, target.minutes, target.seconds, from.hours, from.minutes, from.seconds,
+				 step_every ? ", with jumps" : "", static_cast<unsigned long> (errors));
+	host::check (errors == 0, "Countdown doesn't match the reference formula");
+}
+
+} // namespace
+
+
+int
+main()
+{
+	// Clock::kMagicTimeOfDay:
+	test_day ({ 0x13, 0x37, 0x00 }, { 0x00, 0x00, 0x00 }, 0);
+	test_day ({ 0x13, 0x37, 0x00 }, { 0x13, 0x36, 0x58 }, 0);
+	test_day ({ 0x13, 0x37, 0x00 }, { 0x07, 0x12, 0x34 }, 997);
+	test_day ({ 0x00, 0x00, 0x00 }, { 0x23, 0x59, 0x00 }, 0);
+	test_day ({ 0x23, 0x59, 0x59 }, { 0x00, 0x00, 0x00 }, 0);
+
+	return host::result ("countdown_test");
+}
+
@@ -0,0 +1,289 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+/**
+ * Builds the multiplexed display for 4, 6 and 8 digits and runs its Timer0
+ * interrupt over whole frames against mocked ports and timer: checks that
+ * only one digit is selected at a time, that it shows its own segments,
+ * that equal digits get equal duty, and that modulation periods and frames
+ * take as long as the refresh rate says, regardless of interrupt latency.
+ */
+
+#include "host.h"
+
+
+// Mocks of the registers used by BasicDisplay:
+
+#define F_CPU 8000000L
+#define ISR(vector) void vector()
+
+enum
+{
+	WGM01 = 1,
+	OCIE0A = 1,
+};
+
+uint8_t volatile PORTB, PORTC, PORTD, PORTE, PORTF;
+uint8_t volatile DDRB, DDRC, DDRD, DDRE, DDRF;
+uint8_t TCCR0A;
+uint8_t TCCR0B;
+uint8_t OCR0A;
+uint8_t TCNT0;
+uint8_t TIMSK0;
+
+
+// Mulabs:
+template<class T>
+	constexpr bool
+	get_bit (T value, uint8_t bit)
+	{
+		return (value >> bit) & 1;
+	}
+
+
+// Local:
+#include "font.h"
+#include "display_content.h"
+#include "display.h"
+
+
+namespace {
+
+/**
+ * Clock1337Pinout with two more digits on port D.
+ */
+struct SixDigitPinout
+{
+	static constexpr DisplayPin kDigitPins[] = {
+		{ DisplayPort::D, 7 },
+		{ DisplayPort::B, 6 },
+		{ DisplayPort::C, 6 },
+		{ DisplayPort::F, 7 },
+		{ DisplayPort::D, 0 },
+		{ DisplayPort::D, 1 },
+	};
+
+	static constexpr DisplayPin kSegmentPins[] = {
+		{ DisplayPort::B, 4 },
+		{ DisplayPort::D, 6 },
+		{ DisplayPort::F, 5 },
+		{ DisplayPort::F, 1 },
+		{ DisplayPort::F, 0 },
+		{ DisplayPort::B, 5 },
+		{ DisplayPort::F, 6 },
+		{ DisplayPort::F, 4 },
+	};
+};
+
+
+/**
+ * Two 4-digit panels sharing segment lines.
+ */
+struct EightDigitPinout
+{
+	static constexpr DisplayPin kDigitPins[] = {
+		{ DisplayPort::D, 7 },
+		{ DisplayPort::B, 6 },
+		{ DisplayPort::C, 6 },
+		{ DisplayPort::F, 7 },
+		{ DisplayPort::D, 0 },
+		{ DisplayPort::D, 1 },
+		{ DisplayPort::D, 2 },
+		{ DisplayPort::D, 3 },
+	};
+
+	static constexpr DisplayPin kSegmentPins[] = {
+		{ DisplayPort::B, 4 },
+		{ DisplayPort::D, 6 },
+		{ DisplayPort::F, 5 },
+		{ DisplayPort::F, 1 },
+		{ DisplayPort::F, 0 },
+		{ DisplayPort::B, 5 },
+		{ DisplayPort::F, 6 },
+		{ DisplayPort::F, 4 },
+	};
+};
+
+
+constexpr DisplayPin SixDigitPinout::kDigitPins[];
+constexpr DisplayPin SixDigitPinout::kSegmentPins[];
+constexpr DisplayPin EightDigitPinout::kDigitPins[];
+constexpr DisplayPin EightDigitPinout::kSegmentPins[];
+
+
+uint8_t
+port_value (DisplayPort port)
+{
+	switch (port)
+	{
+		case DisplayPort::B:	return PORTB;
+		case DisplayPort::C:	return PORTC;
+		case DisplayPort::D:	return PORTD;
+		case DisplayPort::E:	return PORTE;
+		default:				return PORTF;
+	}
+}
+
+
+bool
+pin_level (DisplayPin const& pin)
+{
+	return (port_value (pin.port) >> pin.bit) & 1;
+}
+
+
+uint32_t
+timer_prescaler (uint8_t clock_select)
+{
+	switch (clock_select)
+	{
+		case 0b001:	return 1;
+		case 0b010:	return 8;
+		case 0b011:	return 64;
+		case 0b100:	return 256;
+		default:	return 1024;
+	}
+}
+
+
+/**
+ * Run two frames with given interrupt latency, that is cycles from compare
+ * match to the point where the handler sets up the timer, and check the
+ * second one.
+ */
+template<uint8_t pDigitsCount, class pPinout>
+	void
+	test_display (uint16_t latency_cycles)
+	{
+		using Display = BasicDisplay<pDigitsCount, pPinout>;
+		using Pinout = pPinout;
+
+		constexpr uint8_t kRefreshRateHz = 200;
+		constexpr uint8_t kBits = Display::kModulationBits;
+		constexpr uint32_t kUnitCycles = F_CPU / (1UL * kRefreshRateHz * pDigitsCount) / ((1 << kBits) - 1);
+
+		Display display;
+		display.set_brightness (Display::kBrightnessLevels - 1);
+		display.set_all_digits (8);
+		display.set_enabled (true);
+		display.publish();
+		display.template start_scanning<kRefreshRateHz>();
+
+		// Selected time of each digit in modulation units, the frame length in CPU cycles
+		// and the largest difference of a single period from its nominal length:
+		uint16_t units[pDigitsCount] = { };
+		uint32_t frame_cycles = 0;
+		uint32_t max_period_error = 0;
+		bool periods_right = true;
+		bool exclusive = true;
+		bool segments_right = true;
+
+		// Time of the last compare match. The prescaler is free-running, so the timer
+		// ticks on multiples of the prescaler value:
+		uint32_t match_time = 0;
+
+		// Skip the first frame, the front buffer is taken on the first digit switch:
+		for (uint16_t i = 0; i < 2 * pDigitsCount * kBits; ++i)
+		{
+			// Count stays at OCR0A for one tick after the match, then CTC clears it:
+			uint32_t const previous_prescaler = timer_prescaler (TCCR0B);
+			uint32_t const ticks = (match_time + latency_cycles) / previous_prescaler - match_time / previous_prescaler;
+			TCNT0 = ticks == 0 ? OCR0A : ticks - 1;
+
+			Display::handle_interrupt();
+
+			// Timer is reloaded a bit later, counts up to OCR0A and matches again:
+			uint32_t const prescaler = timer_prescaler (TCCR0B);
+			uint32_t const reload_time = match_time + latency_cycles + Display::kCountReloadCycles;
+			uint32_t const next_match_time = (reload_time / prescaler + OCR0A - TCNT0) * prescaler;
+			uint32_t const period_cycles = next_match_time - match_time;
+
+			match_time = next_match_time;
+
+			if (i < pDigitsCount * kBits)
+				continue;
+
+			uint8_t const period = i % kBits;
+			uint32_t const nominal_cycles = kUnitCycles << (kBits - 1 - period);
+			uint32_t const period_error = period_cycles > nominal_cycles ? period_cycles - nominal_cycles : nominal_cycles - period_cycles;
+
+			// Only rounding to timer ticks is allowed:
+			if (period_error > (previous_prescaler > prescaler ? previous_prescaler : prescaler) + prescaler / 2)
+				periods_right = false;
+
+			if (period_error > max_period_error)
+				max_period_error = period_error;
+
+			frame_cycles += period_cycles;
+			uint8_t selected = 0;
+
+			for (uint8_t d = 0; d < pDigitsCount; ++d)
+			{
+				if (!pin_level (Pinout::kDigitPins[d]))
+					continue;
+
+				++selected;
+				units[d] += 1 << (kBits - 1 - period);
+
+				// Digit must be selected only within its own slot, with its own segments:
+				uint8_t segments = 0;
+
+				for (uint8_t s = 0; s < 8; ++s)
+					segments |= pin_level (Pinout::kSegmentPins[s]) << s;
+
+				if (d != i / kBits % pDigitsCount || segments != font::glyph ('8'))
+					segments_right = false;
+			}
+
+			if (selected > 1)
+				exclusive = false;
+		}
+
+		uint32_t const expected_cycles = F_CPU / kRefreshRateHz;
+		uint32_t const error_cycles = frame_cycles > expected_cycles ? frame_cycles - expected_cycles : expected_cycles - frame_cycles;
+		bool equal_units = true;
+
+		for (uint8_t d = 1; d < pDigitsCount; ++d)
+			if (units[d] != units[0])
+				equal_units = false;
+
+		std::printf ("%u digits, latency %u cycles: %u modulation bits, %u of %u units lit per digit, frame %lu cycles (expected %lu), max period error %lu cycles\n",
+					 pDigitsCount, latency_cycles, kBits, units[0], (1 << kBits) - 1,
+					 static_cast<unsigned long> (frame_cycles), static_cast<unsigned long> (expected_cycles),
+					 static_cast<unsigned long> (max_period_error));
+
+		host::check (exclusive, "more than one digit selected at a time");
+		host::check (segments_right, "digit selected outside of its slot or with wrong segments");
+		host::check (equal_units && units[0] > 0, "equal digits don't get equal duty");
+		host::check (periods_right, "modulation period length depends on interrupt latency");
+		host::check (error_cycles * 50 <= expected_cycles, "frame length is off by more than 2%");
+	}
+
+} // namespace
+
+
+int
+main()
+{
+	uint16_t const latencies[] = { 20, 32, 100 };
+
+	for (uint16_t latency_cycles: latencies)
+	{
+		test_display<4, Clock1337Pinout> (latency_cycles);
+		test_display<6, SixDigitPinout> (latency_cycles);
+		test_display<8, EightDigitPinout> (latency_cycles);
+	}
+
+	return host::result ("display_test");
+}
+
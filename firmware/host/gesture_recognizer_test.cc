@@ -0,0 +1,128 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+/**
+ * Feeds GestureRecognizer with button edges and ticks and compares
+ * recognized gestures with the expected ones.
+ */
+
+#include "host.h"
+
+// Local:
+#include "gesture_recognizer.h"
+
+
+namespace {
+
+using Type = GestureRecognizer::Type;
+
+
+struct Edge
+{
+	uint16_t	time_ms;
+	bool		pressed;
+};
+
+
+char const*
+type_name (Type type)
+{
+	switch (type)
+	{
+		case Type::Click:		return "Click";
+		case Type::DoubleClick:	return "DoubleClick";
+		case Type::LongPress:	return "LongPress";
+		case Type::Release:		return "Release";
+	}
+
+	return "?";
+}
+
+
+/**
+ * Feed given edges, with ticks every tick_ms in between, and compare
+ * recognized gestures with the expected ones.
+ */
+template<size_t EdgesCount, size_t GesturesCount>
+	void
+	expect (char const* what, Edge const (&edges)[EdgesCount], GestureRecognizer::Gesture const (&expected)[GesturesCount], uint16_t tick_ms = 10)
+	{
+		GestureRecognizer recognizer (1000, 300);
+		GestureRecognizer::Gesture seen[16] = { };
+		uint8_t seen_count = 0;
+		size_t next_edge = 0;
+
+		for (uint32_t t = 0; t <= edges[EdgesCount - 1].time_ms + 3000U; ++t)
+		{
+			GestureRecognizer::Gestures gestures;
+
+			if (next_edge < EdgesCount && edges[next_edge].time_ms == t)
+			{
+				gestures = edges[next_edge].pressed
+					? recognizer.press (1000 * t)
+					: recognizer.release (1000 * t);
+				++next_edge;
+			}
+			else if (t % tick_ms == 0 && recognizer.needs_ticks())
+				gestures = recognizer.tick (1000 * t);
+
+			for (uint8_t i = 0; i < gestures.count; ++i)
+				if (seen_count < 16)
+					seen[seen_count++] = gestures.list[i];
+		}
+
+		bool ok = seen_count == GesturesCount && !recognizer.needs_ticks();
+
+		for (size_t i = 0; ok && i < GesturesCount; ++i)
+			ok = seen[i] == expected[i];
+
+		if (!ok)
+		{
+			std::fprintf (stderr, "%s, recognized:", what);
+
+			for (uint8_t i = 0; i < seen_count; ++i)
+				std::fprintf (stderr, " %s/%u", type_name (seen[i].type), seen[i].level);
+
+			std::fprintf (stderr, "\n");
+		}
+
+		host::check (ok, what);
+	}
+
+} // namespace
+
+
+int
+main()
+{
+	expect ("click", { { 0, true }, { 100, false } },
+			{ { Type::Click, 1 } });
+	expect ("double-click", { { 0, true }, { 100, false }, { 250, true }, { 350, false } },
+			{ { Type::Click, 1 }, { Type::Click, 1 }, { Type::DoubleClick, 2 } });
+	expect ("triple click", { { 0, true }, { 100, false }, { 250, true }, { 350, false }, { 500, true }, { 600, false } },
+			{ { Type::Click, 1 }, { Type::Click, 1 }, { Type::DoubleClick, 2 }, { Type::Click, 1 } });
+	expect ("slow clicks", { { 0, true }, { 100, false }, { 500, true }, { 600, false } },
+			{ { Type::Click, 1 }, { Type::Click, 1 } });
+	expect ("click length", { { 0, true }, { 990, false } },
+			{ { Type::Click, 1 } });
+	expect ("long press", { { 0, true }, { 2500, false } },
+			{ { Type::LongPress, 2 }, { Type::LongPress, 3 }, { Type::Release, 3 } });
+	// Levels come from edge timestamps, so late ticks only delay LongPress:
+	expect ("long press with late ticks", { { 0, true }, { 2500, false } },
+			{ { Type::LongPress, 2 }, { Type::LongPress, 3 }, { Type::Release, 3 } }, 700);
+	expect ("release before a late tick", { { 0, true }, { 1200, false } },
+			{ { Type::Release, 2 } }, 1500);
+
+	return host::result ("gesture_recognizer_test");
+}
+
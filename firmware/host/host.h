@@ -0,0 +1,73 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__HOST__HOST__INCLUDED
+#define CLOCK_1337__HOST__HOST__INCLUDED
+
+// Standard:
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+
+/**
+ * Minimal support for host-side tests. Firmware headers don't include
+ * their dependencies (the firmware is a single translation unit), so each
+ * test includes what the tested headers need, or provides mocks in their place.
+ */
+namespace host {
+
+/**
+ * Return number of failed checks so far.
+ */
+inline int&
+failures()
+{
+	static int count = 0;
+	return count;
+}
+
+
+/**
+ * Report failure if condition is false.
+ */
+inline void
+check (bool condition, char const* what)
+{
+	if (!condition)
+	{
+		std::fprintf (stderr, "FAILED: %s\n", what);
+		++failures();
+	}
+}
+
+
+/**
+ * Print summary and return exit code for main().
+ */
+inline int
+result (char const* test_name)
+{
+	if (failures() == 0)
+		std::printf ("%s: OK\n", test_name);
+	else
+		std::printf ("%s: %d check(s) failed\n", test_name, failures());
+
+	return failures() == 0 ? 0 : 1;
+}
+
+} // namespace host
+
+#endif
+
@@ -0,0 +1,89 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+/**
+ * Checks LatencyHistogram binning, clamping, min/max and saturation.
+ */
+
+#include "host.h"
+
+// Local:
+#include "latency_histogram.h"
+
+
+namespace {
+
+using Histogram = LatencyHistogram;
+
+constexpr int32_t kBinWidthUs { 1 << Histogram::kBinWidthBits };
+
+
+void
+test_bins()
+{
+	host::check (Histogram::bin (-1) == Histogram::kBinsCount / 2 - 1, "negative latency must go below the middle bin");
+	host::check (Histogram::bin (kBinWidthUs - 1) == Histogram::kBinsCount / 2, "bin is too narrow");
+	host::check (Histogram::bin (kBinWidthUs) == Histogram::kBinsCount / 2 + 1, "bin is too wide");
+	host::check (Histogram::bin (Histogram::kLowestUs) == 0, "lowest latency must start the first bin");
+	host::check (Histogram::bin (-1000000) == 0, "early latencies must be clamped");
+	host::check (Histogram::bin (1000000) == Histogram::kBinsCount - 1, "late latencies must be clamped");
+
+	// Every latency in range goes to the bin that starts at most one bin width before it:
+	for (int32_t latency = Histogram::kLowestUs; latency < -Histogram::kLowestUs; ++latency)
+	{
+		int32_t const bin_start = Histogram::kLowestUs + Histogram::bin (latency) * kBinWidthUs;
+
+		if (latency < bin_start || latency >= bin_start + kBinWidthUs)
+		{
+			host::check (false, "latency put in a wrong bin");
+			break;
+		}
+	}
+}
+
+
+void
+test_samples()
+{
+	Histogram histogram;
+
+	histogram.add (120);
+	histogram.add (-300);
+	histogram.add (5000);
+
+	host::check (histogram.samples() == 3, "samples not counted");
+	host::check (histogram.min_us() == -300 && histogram.max_us() == 5000, "min/max must be exact");
+	host::check (histogram.count (Histogram::bin (120)) == 1, "sample not binned");
+	host::check (histogram.count (Histogram::kBinsCount - 1) == 1, "clamped sample not binned");
+
+	// Counters saturate instead of wrapping:
+	for (uint32_t i = 0; i < 70000; ++i)
+		histogram.add (0);
+
+	host::check (histogram.samples() == 0xffff, "samples count doesn't saturate");
+	host::check (histogram.count (Histogram::bin (0)) == 0xffff, "bin count doesn't saturate");
+	host::check (histogram.min_us() == -300 && histogram.max_us() == 5000, "min/max changed by saturation");
+}
+
+} // namespace
+
+
+int
+main()
+{
+	test_bins();
+	test_samples();
+
+	return host::result ("latency_histogram_test");
+}
+
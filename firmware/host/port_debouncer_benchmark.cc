@@ -0,0 +1,254 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+/**
+ * Feeds PortDebouncer with synthetic bouncing waveforms and reports false
+ * triggers and latency distribution. Each pin gets its own pseudo-random
+ * waveform: stable periods with short glitches, and transitions that bounce
+ * for a while before settling.
+ *
+ * Fails if bounces and glitches shorter than the debounce time cause false
+ * triggers or missed transitions, or if it can't detect false triggers
+ * caused by pulses as long as the debounce time.
+ */
+
+#include "host.h"
+
+// Local:
+#include "port_debouncer.h"
+
+
+namespace {
+
+constexpr uint8_t kMaxLatency { 63 };
+
+
+struct Waveform
+{
+	char const*	name;
+	// Samples between transitions:
+	uint16_t	stable_samples;
+	// Samples of bouncing after each transition:
+	uint8_t		bounce_samples;
+	// Longest single bounce or glitch pulse, in samples:
+	uint8_t		max_pulse_samples;
+	// Transitions to simulate on each pin:
+	uint8_t		transitions;
+};
+
+
+struct Result
+{
+	uint16_t	transitions					= 0;
+	uint16_t	detected					= 0;
+	uint16_t	false_triggers				= 0;
+	uint16_t	min_latency					= 0xffff;
+	uint16_t	max_latency					= 0;
+	uint32_t	total_latency				= 0;
+	// Detections by latency in samples, the last one counts all longer ones:
+	uint16_t	latencies[kMaxLatency + 1]	= { };
+};
+
+
+/**
+ * 16-bit Galois LFSR step.
+ */
+uint16_t
+lfsr_next (uint16_t state)
+{
+	return (state >> 1) ^ (-(state & 1) & 0xb400);
+}
+
+
+/**
+ * Run all 8 pins through given waveform, each with a different seed.
+ */
+Result
+run (Waveform const& waveform)
+{
+	Result result;
+	PortDebouncer debouncer (0xff);
+
+	uint16_t random[8] = { };
+	// True level of each pin and sample on which it last changed:
+	bool level[8] = { };
+	uint32_t changed_at[8] = { };
+	// Level currently output during bouncing/glitch and samples left to the next pulse edge:
+	bool output[8] = { };
+	uint8_t pulse_left[8] = { };
+	// Debounced transitions seen since the last true transition:
+	uint8_t detections[8] = { };
+
+	for (uint8_t p = 0; p < 8; ++p)
+	{
+		random[p] = 0xace1 + 0x1111 * p;
+		level[p] = output[p] = true;
+	}
+
+	uint16_t const period = waveform.stable_samples + waveform.bounce_samples;
+	uint32_t const samples_count = 1UL * period * waveform.transitions;
+
+	// Run for one more period without transitions, to let the last ones settle:
+	for (uint32_t t = 0; t < samples_count + period; ++t)
+	{
+		uint8_t port = 0;
+
+		for (uint8_t p = 0; p < 8; ++p)
+		{
+			// Pins are shifted in time against each other:
+			uint16_t const phase = (t + 37U * p) % period;
+
+			if (phase == 0 && t < samples_count)
+			{
+				level[p] = !level[p];
+				changed_at[p] = t;
+				result.transitions++;
+				detections[p] = 0;
+			}
+
+			random[p] = lfsr_next (random[p]);
+
+			if (phase < waveform.bounce_samples && t - changed_at[p] < waveform.bounce_samples)
+			{
+				// Bouncing: random pulses, no longer than max_pulse_samples:
+				if (pulse_left[p] == 0)
+				{
+					output[p] = !output[p];
+					pulse_left[p] = 1 + random[p] % waveform.max_pulse_samples;
+				}
+
+				--pulse_left[p];
+			}
+			else if (output[p] != level[p])
+			{
+				// Glitch in progress:
+				if (pulse_left[p] == 0)
+					output[p] = level[p];
+				else
+					--pulse_left[p];
+			}
+			else if ((random[p] & 0xff) == 0)
+			{
+				// Rare glitch during stable period:
+				output[p] = !level[p];
+				pulse_left[p] = random[p] % waveform.max_pulse_samples;
+			}
+			else
+				output[p] = level[p];
+
+			port |= output[p] << p;
+		}
+
+		uint8_t const changed = debouncer.sample (port);
+
+		for (uint8_t p = 0; p < 8; ++p)
+		{
+			if (changed & (1 << p))
+			{
+				if (++detections[p] == 1 && ((debouncer.levels() >> p) & 1) == level[p])
+				{
+					uint32_t const latency = t - changed_at[p];
+
+					result.detected++;
+					result.total_latency += latency;
+					result.latencies[latency < kMaxLatency ? latency : kMaxLatency]++;
+
+					if (latency < result.min_latency)
+						result.min_latency = latency;
+
+					if (latency > result.max_latency)
+						result.max_latency = latency;
+				}
+				else
+					result.false_triggers++;
+			}
+		}
+	}
+
+	return result;
+}
+
+
+void
+print (Waveform const& waveform, Result const& result)
+{
+	std::printf ("%s (stable %u, bounce %u, pulses up to %u samples):\n",
+				 waveform.name, waveform.stable_samples, waveform.bounce_samples, waveform.max_pulse_samples);
+	std::printf ("  transitions %u, detected %u, false triggers %u\n",
+				 result.transitions, result.detected, result.false_triggers);
+
+	if (result.detected == 0)
+		return;
+
+	std::printf ("  latency %u…%u samples, average %.1f\n",
+				 result.min_latency, result.max_latency, 1.0 * result.total_latency / result.detected);
+
+	for (uint8_t latency = 0; latency <= kMaxLatency; ++latency)
+	{
+		if (result.latencies[latency] == 0)
+			continue;
+
+		std::printf ("  %s%2u: %4u ", latency == kMaxLatency ? "≥" : " ", latency, result.latencies[latency]);
+
+		for (uint16_t i = 0; i < (result.latencies[latency] + 3) / 4; ++i)
+			std::putchar ('#');
+
+		std::putchar ('\n');
+	}
+}
+
+
+/**
+ * Run and print given waveform. Expect every transition to be found exactly
+ * once, with latency not greater than bouncing time (including the last pulse),
+ * plus a glitch that might come right after, plus debounce time.
+ */
+void
+expect_pass (Waveform const& waveform)
+{
+	Result const result = run (waveform);
+
+	print (waveform, result);
+	host::check (result.false_triggers == 0, "debouncer triggers on bounces");
+	host::check (result.detected == result.transitions, "debouncer misses transitions");
+	host::check (result.max_latency <= waveform.bounce_samples + 2 * waveform.max_pulse_samples + PortDebouncer::kSamplesCount - 1,
+				 "debounce latency is too long");
+}
+
+} // namespace
+
+
+int
+main()
+{
+	constexpr uint8_t kSamples = PortDebouncer::kSamplesCount;
+
+	// Clean edges: debounced exactly kSamplesCount - 1 samples after the edge:
+	Waveform const clean { "clean edges", 50, 0, 1, 20 };
+	Result const clean_result = run (clean);
+	print (clean, clean_result);
+	host::check (clean_result.min_latency == kSamples - 1 && clean_result.max_latency == kSamples - 1, "clean edge latency is wrong");
+
+	// Bounces and glitches shorter than the debounce time must never trigger:
+	expect_pass ({ "short pulses", 100, 10, kSamples - 1, 40 });
+	expect_pass ({ "long bouncing", 60, 25, 2, 40 });
+
+	// And the benchmark must be able to tell when they do:
+	Waveform const long_pulses { "pulses as long as debounce time", 100, 10, kSamples, 40 };
+	Result const long_result = run (long_pulses);
+	print (long_pulses, long_result);
+	host::check (long_result.false_triggers > 0, "benchmark doesn't catch false triggers");
+
+	return host::result ("port_debouncer_benchmark");
+}
+
@@ -0,0 +1,293 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+/**
+ * Runs ShiftRegisterDisplay against a bit-level model of a chain of 74HC595
+ * shift registers, fed by a mocked SPI and latch pin, and checks what shows
+ * up on chip outputs and how many bytes it takes.
+ */
+
+#include "host.h"
+
+// System:
+#include <util/atomic.h>
+
+
+namespace simulation {
+
+/**
+ * Chain of 74HC595 shift registers. Chip 0 is the one connected to MOSI,
+ * each next one is fed from QH' of the previous.
+ */
+template<uint8_t pChipsCount>
+	struct Chain
+	{
+		// Shift register and storage (output) register of each chip; bit 0 is QA, bit 7 is QH:
+		uint8_t		shift[pChipsCount]		= { };
+		uint8_t		storage[pChipsCount]	= { };
+		// Transfer cost counters:
+		uint16_t	bytes_shifted			= 0;
+		uint16_t	latches					= 0;
+
+		/**
+		 * Clock a single bit into SER of chip 0.
+		 */
+		void
+		shift_bit (bool bit)
+		{
+			for (uint8_t c = 0; c < pChipsCount; ++c)
+			{
+				bool const carry = shift[c] >> 7;
+				shift[c] = static_cast<uint8_t> (shift[c] << 1) | bit;
+				bit = carry;
+			}
+		}
+
+		/**
+		 * Clock a byte in the way the SPI does it, MSB first.
+		 */
+		void
+		shift_byte (uint8_t byte)
+		{
+			for (int8_t b = 7; b >= 0; --b)
+				shift_bit ((byte >> b) & 1);
+
+			++bytes_shifted;
+		}
+
+		/**
+		 * Pulse RCLK: copy shift registers to outputs.
+		 */
+		void
+		latch()
+		{
+			for (uint8_t c = 0; c < pChipsCount; ++c)
+				storage[c] = shift[c];
+
+			++latches;
+		}
+	};
+
+
+Chain<4>	chain;
+// SPI has a byte to send, SPI interrupt is due once it's sent:
+bool		spi_busy	{ false };
+bool		latch_level	{ false };
+
+} // namespace simulation
+
+
+// Mocks of the registers and pins used by ShiftRegisterDisplay:
+
+#define F_CPU 8000000L
+
+enum
+{
+	WGM00, WGM01, COM0A0 = 6, COM0A1,
+	SPI2X = 0, MSTR = 4, SPE = 6, SPIE,
+};
+
+uint8_t TCCR0A;
+uint8_t TCCR0B;
+uint8_t OCR0A;
+uint8_t SPCR;
+uint8_t SPSR;
+
+
+struct SpiDataRegister
+{
+	SpiDataRegister&
+	operator= (uint8_t byte)
+	{
+		host::check (!simulation::spi_busy, "SPDR written while the previous byte is being sent");
+		simulation::chain.shift_byte (byte);
+		simulation::spi_busy = true;
+		return *this;
+	}
+};
+
+SpiDataRegister SPDR;
+
+
+/**
+ * Latch (PB6) is the only pin of interest here.
+ */
+class Pin
+{
+  public:
+	constexpr
+	Pin (uint8_t port, uint8_t bit):
+		_port (port), _bit (bit)
+	{ }
+
+	void
+	operator= (bool level) const
+	{
+		if (_port == 1 && _bit == 6)
+		{
+			if (level && !simulation::latch_level)
+				simulation::chain.latch();
+
+			simulation::latch_level = level;
+		}
+	}
+
+	void
+	configure_as_output() const
+	{ }
+
+  private:
+	uint8_t	_port;
+	uint8_t	_bit;
+};
+
+
+class Port
+{
+  public:
+	constexpr
+	Port (uint8_t port):
+		_port (port)
+	{ }
+
+	constexpr Pin
+	pin (uint8_t bit) const
+	{
+		return { _port, bit };
+	}
+
+  private:
+	uint8_t	_port;
+};
+
+
+class MCU
+{
+  public:
+	using Pin = ::Pin;
+
+	static constexpr Port port_b { 1 };
+};
+
+constexpr Port MCU::port_b;
+
+
+// Local:
+#include "font.h"
+#include "display_content.h"
+#include "shift_register_display.h"
+
+
+namespace {
+
+using Display = ShiftRegisterDisplay<4, Clock1337ShiftRegisterPinout>;
+
+
+/**
+ * Run SPI interrupts until the display stops sending.
+ */
+void
+run_transfers()
+{
+	while (simulation::spi_busy)
+	{
+		simulation::spi_busy = false;
+		Display::handle_interrupt();
+	}
+}
+
+
+/**
+ * Return true if chip outputs show given segments.
+ */
+bool
+shows (uint8_t const (&segments)[4])
+{
+	for (uint8_t d = 0; d < 4; ++d)
+		if (simulation::chain.storage[d] != segments[d])
+			return false;
+
+	return true;
+}
+
+
+void
+test_frames()
+{
+	using simulation::chain;
+
+	Display display;
+	display.set_enabled (true);
+	display.set_brightness (Display::kBrightnessLevels - 1);
+	display.set_digits (1, 2, 3, 4);
+	display.set_dp (1, true);
+	display.set_digit_enabled (2, false);
+	// Not sent until started:
+	display.publish();
+	host::check (chain.bytes_shifted == 0, "frame sent before start_scanning()");
+
+	display.start_scanning<200>();
+	run_transfers();
+
+	uint8_t const first[4] = { font::glyph ('1'), static_cast<uint8_t> (font::glyph ('2') | font::kDotBit), 0, font::glyph ('4') };
+	host::check (shows (first), "frame doesn't come out right on chip outputs");
+	host::check (chain.bytes_shifted == 4 && chain.latches == 1, "frame takes more than a byte per digit and a single latch");
+	host::check (OCR0A == 0xff && TCCR0A == ((1 << COM0A1) | (1 << COM0A0) | (1 << WGM01) | (1 << WGM00)), "brightness PWM not set up with the latch");
+
+	// The second frame must replace the first one entirely:
+	display.set_digits (8, 8, 8, 8);
+	display.set_digit_enabled (2, true);
+	display.publish();
+	run_transfers();
+
+	uint8_t const second[4] = { font::glyph ('8'), static_cast<uint8_t> (font::glyph ('8') | font::kDotBit), font::glyph ('8'), font::glyph ('8') };
+	host::check (shows (second), "second frame doesn't replace the first one");
+	host::check (chain.bytes_shifted == 8 && chain.latches == 2, "second frame isn't sent the same way");
+
+	// Frames published during a transfer: only the newest one is sent after it:
+	display.set_digits (5, 5, 5, 5);
+	display.publish();
+	simulation::spi_busy = false;
+	Display::handle_interrupt();
+	display.set_digits (6, 6, 6, 6);
+	display.publish();
+	display.set_digits (7, 7, 7, 7);
+	display.publish();
+	run_transfers();
+
+	uint8_t const newest[4] = { font::glyph ('7'), static_cast<uint8_t> (font::glyph ('7') | font::kDotBit), font::glyph ('7'), font::glyph ('7') };
+	host::check (shows (newest), "newest frame isn't shown");
+	host::check (chain.bytes_shifted == 16 && chain.latches == 4, "frames published during a transfer aren't merged");
+
+	// Disabled display must come out blank:
+	display.set_enabled (false);
+	display.publish();
+	run_transfers();
+
+	uint8_t const blank[4] = { };
+	host::check (shows (blank), "disabled display isn't blank");
+
+	std::printf ("%u bytes and %u latches for 5 frames\n", chain.bytes_shifted, chain.latches);
+}
+
+} // namespace
+
+
+int
+main()
+{
+	test_frames();
+
+	return host::result ("shift_register_display_test");
+}
+
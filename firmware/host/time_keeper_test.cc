@@ -0,0 +1,308 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+/**
+ * Runs TimeKeeper against a simulated system clock and DS1302 and checks
+ * that it stays locked to the RTC second edges: displayed seconds match the
+ * RTC, local edges come within a poll of the RTC ones, and the resync
+ * interval grows as long as the drift is small.
+ */
+
+#include "host.h"
+
+// Local:
+#include "bcd.h"
+#include "fixed_point.h"
+#include "time.h"
+
+
+namespace simulation {
+
+// TimeKeeper::update() is called by the scheduler every millisecond:
+constexpr uint32_t	kLoopUs				{ 1000 };
+// Seconds poll and burst read duration, RTCTransaction is stepped on every
+// main loop pass, that is every ~40 µs:
+constexpr uint32_t	kPollUs				{ 34 * 40 };
+constexpr uint32_t	kBurstReadUs		{ 290 * 40 };
+
+uint32_t			now_us				{ 0 };
+
+
+/**
+ * RTC ticking at its own rate, with its first edge at a given time.
+ */
+struct RTCModel
+{
+	uint32_t	first_edge_us	{ 0 };
+	uint32_t	second_us		{ 1000000 };
+	Time		start_time		{ 0x12, 0x00, 0x00 };
+
+	/**
+	 * Return time shown by the RTC at given time.
+	 */
+	Time
+	time_at (uint32_t time_us) const
+	{
+		Time result = start_time;
+
+		if (time_us >= first_edge_us)
+			for (uint32_t s = (time_us - first_edge_us) / second_us + 1; s > 0; --s)
+				result.increment_seconds();
+
+		return result;
+	}
+
+	/**
+	 * Return time of the last edge at or before given time.
+	 */
+	uint32_t
+	last_edge (uint32_t time_us) const
+	{
+		return first_edge_us + (time_us - first_edge_us) / second_us * second_us;
+	}
+};
+
+
+RTCModel rtc_model;
+
+} // namespace simulation
+
+
+// Mocks of the classes used by TimeKeeper:
+
+class SystemClock
+{
+  public:
+	static uint32_t
+	micros()
+	{
+		return simulation::now_us;
+	}
+};
+
+
+class RTC
+{
+  public:
+	Time
+	get_time()
+	{
+		return simulation::rtc_model.time_at (simulation::now_us);
+	}
+
+	void
+	set_time (Time const&)
+	{ }
+};
+
+
+/**
+ * Registers are sampled after the command byte, that is halfway
+ * through the seconds poll.
+ */
+class RTCTransaction
+{
+  public:
+	void
+	start_read_seconds()
+	{
+		start (simulation::kPollUs);
+	}
+
+	void
+	start_read_time()
+	{
+		start (simulation::kBurstReadUs);
+	}
+
+	void
+	abort()
+	{
+		_busy = false;
+		_succeeded = false;
+	}
+
+	bool
+	busy()
+	{
+		if (_busy && simulation::now_us >= _end_us)
+		{
+			_busy = false;
+			_succeeded = true;
+			_time = simulation::rtc_model.time_at (_sample_us);
+		}
+
+		return _busy;
+	}
+
+	bool
+	succeeded()
+	{
+		return !busy() && _succeeded;
+	}
+
+	uint8_t
+	seconds()
+	{
+		return _time.seconds;
+	}
+
+	Time
+	last_good_time()
+	{
+		return _time;
+	}
+
+  private:
+	void
+	start (uint32_t duration_us)
+	{
+		_busy = true;
+		_succeeded = false;
+		_end_us = simulation::now_us + duration_us;
+		_sample_us = simulation::now_us + simulation::kPollUs / 2;
+	}
+
+  private:
+	bool		_busy		{ false };
+	bool		_succeeded	{ false };
+	uint32_t	_end_us		{ 0 };
+	uint32_t	_sample_us	{ 0 };
+	Time		_time;
+};
+
+
+#include "time_keeper.h"
+
+
+namespace {
+
+struct Result
+{
+	uint16_t	max_resync_interval	= 0;
+	int32_t		last_error_us		= 0;
+	// Checked seconds shown differently than the RTC:
+	uint32_t	wrong_seconds		= 0;
+	// Largest local phase error at the checked points:
+	int32_t		max_phase_error_us	= 0;
+	// Edges reported by take_measured_edge() and largest distance from the RTC edge:
+	uint32_t	measured_edges		= 0;
+	int32_t		max_measured_error	= 0;
+};
+
+
+/**
+ * Run the keeper for given number of seconds with the RTC second of given
+ * length. Check displayed time and phase 100 ms after each RTC edge, once
+ * the first minute (acquisition) has passed. If measure_every is not 0,
+ * request edge measurement every that many seconds.
+ */
+Result
+run (uint32_t rtc_second_us, uint32_t seconds, uint32_t measure_every)
+{
+	using namespace simulation;
+
+	Result result;
+	now_us = 0;
+	rtc_model = RTCModel();
+	rtc_model.first_edge_us = 437000;
+	rtc_model.second_us = rtc_second_us;
+
+	RTC rtc;
+	RTCTransaction transaction;
+	TimeKeeper keeper (rtc, transaction);
+	keeper.start();
+
+	uint32_t next_check_edge_us = rtc_model.first_edge_us + 60 * rtc_second_us;
+	uint32_t checks = 0;
+
+	while (now_us < seconds * 1000000ULL)
+	{
+		now_us += kLoopUs;
+		keeper.update();
+
+		uint32_t edge_us;
+
+		if (keeper.take_measured_edge (edge_us))
+		{
+			int32_t const error = static_cast<int32_t> (edge_us - rtc_model.last_edge (now_us));
+			int32_t const abs_error = error < 0 ? -error : error;
+
+			result.measured_edges++;
+
+			if (keeper.resync_interval() > result.max_resync_interval)
+				result.max_resync_interval = keeper.resync_interval();
+
+			if (abs_error > result.max_measured_error)
+				result.max_measured_error = abs_error;
+		}
+
+		if (now_us >= next_check_edge_us + 100000)
+		{
+			if (keeper.now() != rtc_model.time_at (now_us))
+				result.wrong_seconds++;
+
+			// Phase should be 100 ms into the second:
+			int32_t const phase_us = static_cast<int32_t> ((keeper.phase() * 1000000ULL) >> 16);
+			int32_t const phase_error = phase_us - static_cast<int32_t> (now_us - next_check_edge_us);
+			int32_t const abs_phase_error = phase_error < 0 ? -phase_error : phase_error;
+
+			if (abs_phase_error > result.max_phase_error_us)
+				result.max_phase_error_us = abs_phase_error;
+
+			if (measure_every && ++checks % measure_every == 0)
+				keeper.request_edge_measurement();
+
+			next_check_edge_us += rtc_second_us;
+		}
+	}
+
+	result.last_error_us = keeper.last_error_us();
+
+	return result;
+}
+
+
+void
+test_locking (char const* name, uint32_t rtc_second_us, uint32_t measure_every)
+{
+	Result const result = run (rtc_second_us, 1200, measure_every);
+
+	std::printf ("%s: max resync interval %u s, last error %ld µs, wrong seconds %lu, max phase error %ld µs, measured edges %lu (max error %ld µs)\n",
+				 name, result.max_resync_interval, static_cast<long> (result.last_error_us),
+				 static_cast<unsigned long> (result.wrong_seconds), static_cast<long> (result.max_phase_error_us),
+				 static_cast<unsigned long> (result.measured_edges), static_cast<long> (result.max_measured_error));
+
+	host::check (result.wrong_seconds == 0, "displayed seconds must match the RTC");
+	// Edge is timestamped with the start of the poll that has seen the new second,
+	// which is up to two update periods after the edge:
+	host::check (result.max_measured_error <= static_cast<int32_t> (2 * simulation::kLoopUs), "measured edges must match the RTC ones");
+	// Measurement noise spreads over the resync interval, but stays within a few ms:
+	host::check (result.max_phase_error_us <= 5000, "local second edges must follow the RTC ones");
+	host::check (result.max_resync_interval >= 16, "resync interval must grow when drift is small");
+}
+
+} // namespace
+
+
+int
+main()
+{
+	test_locking ("exact RTC", 1000000, 0);
+	test_locking ("RTC 100 ppm slow", 1000100, 0);
+	test_locking ("RTC 100 ppm fast", 999900, 0);
+	test_locking ("exact RTC, measured every 20 s", 1000000, 20);
+
+	return host::result ("time_keeper_test");
+}
+
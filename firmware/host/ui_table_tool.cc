@@ -0,0 +1,196 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+/**
+ * Checks the UI transition table and prints it:
+ *
+ *   ui_table_tool				check the graph, print transitions and table cost
+ *   ui_table_tool dot			print the graph in Graphviz format
+ *
+ * Fails if some state can't be reached from Clock, or Clock can't be reached
+ * back from it, or if the table refers to states or actions that don't exist.
+ *
+ * Cost on the target is compared with the old handle_button() by hand:
+ *
+ *  - flash: build 74569cf~1 in a separate worktree, then run
+ *    make ui-size UI_SIZE_BASELINE=<that build's 1337-firmware.elf>;
+ *    it adds up handle_button(), its helpers that weren't inlined and
+ *    ui::kTable in both builds and fails if any of them is missing,
+ *  - cycles: read Scheduler::statistics() of the handle_button task
+ *    (max_cost_us) on both builds, after going through all UI states.
+ */
+
+#include "host.h"
+
+// Local:
+#include "ui_table.h"
+
+
+namespace {
+
+char const* const kStateNames[ui::kStatesCount] = {
+	"Clock", "BeepSetup", "SetupHours10", "SetupHours1", "SetupMinutes10", "SetupMinutes1",
+};
+
+char const* const kEventNames[ui::kEventsCount] = {
+	"Click", "Hold2", "Hold3", "Hold4", "Release2", "Release3", "Release4", "Up", "Down",
+};
+
+constexpr uint8_t kActionsCount { 13 };
+
+char const* const kActionNames[kActionsCount] = {
+	"None", "ShowModeOverride", "ShowBeepOverride", "ShowSetOverride", "TogglePrecision", "ToggleDisplayMode",
+	"EnterBeepSetup", "ToggleBeeper", "EnterTimeSetup", "DigitUp", "DigitDown", "NextDigit", "CommitTime",
+};
+
+
+ui::Transition const&
+transition (uint8_t state, uint8_t event)
+{
+	return ui::kTable[state][event];
+}
+
+
+void
+check_values()
+{
+	for (uint8_t s = 0; s < ui::kStatesCount; ++s)
+	{
+		for (uint8_t e = 0; e < ui::kEventsCount; ++e)
+		{
+			host::check (static_cast<uint8_t> (transition (s, e).next) < ui::kStatesCount, "transition to a state that doesn't exist");
+			host::check (static_cast<uint8_t> (transition (s, e).action) < kActionsCount, "transition with an action that doesn't exist");
+		}
+	}
+}
+
+
+/**
+ * Check that every state can be reached from Clock and Clock from every state.
+ */
+void
+check_connected()
+{
+	bool from_clock[ui::kStatesCount] = { true };
+	bool to_clock[ui::kStatesCount] = { true };
+
+	// Reachability by repeated relaxation, the table is tiny:
+	for (uint8_t pass = 0; pass < ui::kStatesCount; ++pass)
+	{
+		for (uint8_t s = 0; s < ui::kStatesCount; ++s)
+		{
+			for (uint8_t e = 0; e < ui::kEventsCount; ++e)
+			{
+				uint8_t const next = static_cast<uint8_t> (transition (s, e).next) % ui::kStatesCount;
+
+				if (from_clock[s])
+					from_clock[next] = true;
+
+				if (to_clock[next])
+					to_clock[s] = true;
+			}
+		}
+	}
+
+	for (uint8_t s = 0; s < ui::kStatesCount; ++s)
+	{
+		if (!from_clock[s])
+			std::printf ("%s can't be reached from Clock\n", kStateNames[s]);
+
+		if (!to_clock[s])
+			std::printf ("%s never returns to Clock\n", kStateNames[s]);
+
+		host::check (from_clock[s] && to_clock[s], "UI table has unreachable or dead-end states");
+	}
+}
+
+
+/**
+ * Print transitions that do something, that is change state or run an action.
+ */
+void
+print_transitions()
+{
+	uint8_t active = 0;
+
+	for (uint8_t s = 0; s < ui::kStatesCount; ++s)
+	{
+		for (uint8_t e = 0; e < ui::kEventsCount; ++e)
+		{
+			ui::Transition const& t = transition (s, e);
+
+			if (t.action == ui::Action::None && static_cast<uint8_t> (t.next) == s)
+				continue;
+
+			std::printf ("  %-14s %-8s → %-14s %s%s\n", kStateNames[s], kEventNames[e], kStateNames[static_cast<uint8_t> (t.next)],
+						 kActionNames[static_cast<uint8_t> (t.action)], t.ignore_press ? ", ignore press" : "");
+			++active;
+		}
+	}
+
+	std::printf ("%u states × %u events, %u transitions do something\n", ui::kStatesCount, ui::kEventsCount, active);
+	std::printf ("table: %zu bytes in flash, %zu bytes read from flash per event\n", sizeof (ui::kTable), sizeof (ui::Transition));
+}
+
+
+/**
+ * Print the graph in Graphviz format. Edges that neither change state
+ * nor run an action are left out.
+ */
+void
+print_dot()
+{
+	std::printf ("digraph ui {\n");
+	std::printf ("\trankdir=LR;\n");
+	std::printf ("\tnode [shape=box];\n");
+
+	for (uint8_t s = 0; s < ui::kStatesCount; ++s)
+	{
+		for (uint8_t e = 0; e < ui::kEventsCount; ++e)
+		{
+			ui::Transition const& t = transition (s, e);
+
+			if (t.action == ui::Action::None && static_cast<uint8_t> (t.next) == s)
+				continue;
+
+			std::printf ("\t%s -> %s [label=\"%s", kStateNames[s], kStateNames[static_cast<uint8_t> (t.next)], kEventNames[e]);
+
+			if (t.action != ui::Action::None)
+				std::printf ("/%s", kActionNames[static_cast<uint8_t> (t.action)]);
+
+			std::printf ("\"%s];\n", t.ignore_press ? ", style=dashed" : "");
+		}
+	}
+
+	std::printf ("}\n");
+}
+
+} // namespace
+
+
+int
+main (int argc, char** argv)
+{
+	if (argc > 1 && std::strcmp (argv[1], "dot") == 0)
+	{
+		print_dot();
+		return 0;
+	}
+
+	check_values();
+	check_connected();
+	print_transitions();
+
+	return host::result ("ui_table_tool");
+}
+
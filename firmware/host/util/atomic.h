@@ -0,0 +1,28 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__HOST__UTIL__ATOMIC__INCLUDED
+#define CLOCK_1337__HOST__UTIL__ATOMIC__INCLUDED
+
+/*
+ * Host replacement for avr-libc <util/atomic.h>: host tests run
+ * "interrupts" synchronously, so the block just runs once.
+ */
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+
+#define ATOMIC_BLOCK(type) for (bool atomic_block_done = false; !atomic_block_done; atomic_block_done = true)
+
+#endif
+
@@ -0,0 +1,138 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__LATENCY_HISTOGRAM__INCLUDED
+#define CLOCK_1337__LATENCY_HISTOGRAM__INCLUDED
+
+/**
+ * Distribution of signed latencies in microseconds.
+ *
+ * Bins are 2^kBinWidthBits µs wide and centered around zero, so bin index is
+ * computed with a shift. Latencies out of range go to the outermost bins,
+ * min() and max() are exact. Counters saturate instead of wrapping.
+ */
+class LatencyHistogram
+{
+  public:
+	static constexpr uint8_t	kBinsCount		{ 16 };
+	static constexpr uint8_t	kBinWidthBits	{ 8 };
+	// Lower end of the first bin:
+	static constexpr int32_t	kLowestUs		{ -(static_cast<int32_t> (kBinsCount / 2) << kBinWidthBits) };
+
+  public:
+	/**
+	 * Add a sample.
+	 */
+	constexpr void
+	add (int32_t latency_us);
+
+	/**
+	 * Return number of samples in given bin. Bin i counts latencies
+	 * from kLowestUs + i * 2^kBinWidthBits µs.
+	 */
+	constexpr uint16_t
+	count (uint8_t bin) const;
+
+	/**
+	 * Return number of samples.
+	 */
+	constexpr uint16_t
+	samples() const;
+
+	/**
+	 * Return lowest latency seen. Valid only if there were samples.
+	 */
+	constexpr int32_t
+	min_us() const;
+
+	/**
+	 * Return highest latency seen. Valid only if there were samples.
+	 */
+	constexpr int32_t
+	max_us() const;
+
+	/**
+	 * Return bin for given latency.
+	 */
+	static constexpr uint8_t
+	bin (int32_t latency_us);
+
+  private:
+	uint16_t	_bins[kBinsCount]	= { };
+	uint16_t	_samples			= 0;
+	int32_t		_min_us				= 0;
+	int32_t		_max_us				= 0;
+};
+
+
+constexpr void
+LatencyHistogram::add (int32_t latency_us)
+{
+	if (_samples == 0 || latency_us < _min_us)
+		_min_us = latency_us;
+
+	if (_samples == 0 || latency_us > _max_us)
+		_max_us = latency_us;
+
+	if (_samples < 0xffff)
+		_samples++;
+
+	uint16_t& bin_count = _bins[bin (latency_us)];
+
+	if (bin_count < 0xffff)
+		bin_count++;
+}
+
+
+constexpr uint16_t
+LatencyHistogram::count (uint8_t bin) const
+{
+	return _bins[bin];
+}
+
+
+constexpr uint16_t
+LatencyHistogram::samples() const
+{
+	return _samples;
+}
+
+
+constexpr int32_t
+LatencyHistogram::min_us() const
+{
+	return _min_us;
+}
+
+
+constexpr int32_t
+LatencyHistogram::max_us() const
+{
+	return _max_us;
+}
+
+
+constexpr uint8_t
+LatencyHistogram::bin (int32_t latency_us)
+{
+	return latency_us < kLowestUs ? 0
+		: ((latency_us - kLowestUs) >> kBinWidthBits) >= kBinsCount ? kBinsCount - 1
+		: (latency_us - kLowestUs) >> kBinWidthBits;
+}
+
+
+// See host/latency_histogram_test.cc for the rest:
+static_assert (LatencyHistogram::bin (0) == LatencyHistogram::kBinsCount / 2, "zero latency must start the middle bin");
+
+#endif
+
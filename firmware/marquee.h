@@ -0,0 +1,96 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__MARQUEE__INCLUDED
+#define CLOCK_1337__MARQUEE__INCLUDED
+
+/**
+ * Scrolling position of a text longer than the display. The text comes in
+ * from the right, leaves on the left and starts over. Advanced by time,
+ * not by the number of update() calls, so the speed doesn't depend on the load.
+ *
+ * Offset is the index of the text character shown on the leftmost digit,
+ * see Display::set_text().
+ */
+class Marquee
+{
+  public:
+	// Ctor
+	constexpr
+	Marquee (uint8_t text_length, uint8_t window, uint16_t step_ms);
+
+	/**
+	 * Start from the beginning (text just outside of the display on the right).
+	 */
+	void
+	restart (uint32_t now_ms);
+
+	/**
+	 * Advance by as many steps as have passed until now.
+	 */
+	void
+	update (uint32_t now_ms);
+
+	/**
+	 * Return current offset.
+	 */
+	constexpr int8_t
+	offset() const;
+
+  private:
+	int8_t		_first_offset;
+	int8_t		_last_offset;
+	uint16_t	_step_ms;
+	int8_t		_offset;
+	uint32_t	_last_step_ms	= 0;
+};
+
+
+constexpr
+Marquee::Marquee (uint8_t text_length, uint8_t window, uint16_t step_ms):
+	_first_offset (-static_cast<int8_t> (window)),
+	_last_offset (static_cast<int8_t> (text_length) - 1),
+	_step_ms (step_ms),
+	_offset (_first_offset)
+{ }
+
+
+inline void
+Marquee::restart (uint32_t now_ms)
+{
+	_offset = _first_offset;
+	_last_step_ms = now_ms;
+}
+
+
+inline void
+Marquee::update (uint32_t now_ms)
+{
+	while (now_ms - _last_step_ms >= _step_ms)
+	{
+		_last_step_ms += _step_ms;
+
+		if (++_offset > _last_offset)
+			_offset = _first_offset;
+	}
+}
+
+
+constexpr int8_t
+Marquee::offset() const
+{
+	return _offset;
+}
+
+#endif
+
@@ -0,0 +1,112 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__PORT_DEBOUNCER__INCLUDED
+#define CLOCK_1337__PORT_DEBOUNCER__INCLUDED
+
+/**
+ * Debouncer for up to 8 pins of a single port.
+ *
+ * Each pin has a 2-bit counter, kept "vertically": bit 0 of all counters
+ * in one byte, bit 1 in another, so all pins are handled at once with a few
+ * logic operations per sample. A pin's counter runs while its sampled level
+ * differs from the debounced one and is cleared as soon as they agree;
+ * the debounced level flips after kSamplesCount differing samples in a row.
+ *
+ * Must be sampled at a fixed rate, debounce time is kSamplesCount sample
+ * periods. Pins are active-low (pressed button reads 0).
+ */
+class PortDebouncer
+{
+  public:
+	static constexpr uint8_t kSamplesCount { 4 };
+
+  public:
+	// Ctor
+	explicit constexpr
+	PortDebouncer (uint8_t mask);
+
+	/**
+	 * Feed one sample of the port (eg. PIND). Pins outside of the mask are ignored.
+	 * Return mask of pins which changed their debounced level.
+	 */
+	constexpr uint8_t
+	sample (uint8_t port_value);
+
+	/**
+	 * Return debounced levels.
+	 */
+	constexpr uint8_t
+	levels() const;
+
+	/**
+	 * Return mask of pins pressed since the last call and clear it.
+	 */
+	constexpr uint8_t
+	take_presses();
+
+  private:
+	uint8_t	_mask;
+	uint8_t	_levels		= 0xff;
+	uint8_t	_count0		= 0;
+	uint8_t	_count1		= 0;
+	uint8_t	_presses	= 0;
+};
+
+
+constexpr
+PortDebouncer::PortDebouncer (uint8_t mask):
+	_mask (mask)
+{ }
+
+
+constexpr uint8_t
+PortDebouncer::sample (uint8_t port_value)
+{
+	uint8_t const differs = (port_value ^ _levels) & _mask;
+
+	// Count differing pins modulo 4, clear the others:
+	_count1 = (_count1 ^ _count0) & differs;
+	_count0 = ~_count0 & differs;
+
+	// Counter wrapped to 0 while still differing: the 4th sample in a row:
+	uint8_t const changed = differs & ~(_count0 | _count1);
+
+	_levels ^= changed;
+	_presses |= changed & ~_levels;
+
+	return changed;
+}
+
+
+constexpr uint8_t
+PortDebouncer::levels() const
+{
+	return _levels;
+}
+
+
+constexpr uint8_t
+PortDebouncer::take_presses()
+{
+	uint8_t const result = _presses;
+	_presses = 0;
+	return result;
+}
+
+
+// See host/port_debouncer_benchmark.cc for bouncing waveforms:
+static_assert (PortDebouncer (0x01).sample (0x00) == 0, "single differing sample must not change debounced level");
+
+#endif
+
@@ -22,335 +22,601 @@ rtc_write_byte_to_reg (uint8_t command_byte)
 
 
 /**
- * Support for DS1302 RTC clock.
+ * DS1302 AC timing limits from the datasheet, in nanoseconds.
+ * Datasheet specifies them for 2.0 V and 5.0 V supply; for anything below
+ * 5 V the 2.0 V column is used.
  */
-class RTC
-{
-	static constexpr MCU::Pin	_rtc_sclk		{ MCU::port_d.pin (1) };
-	static constexpr MCU::Pin	_rtc_io			{ MCU::port_d.pin (2) };
-	static constexpr MCU::Pin	_rtc_ce			{ MCU::port_d.pin (3) };
-
-	enum class Direction: uint8_t
+template<uint16_t SupplyMillivolts, bool Fast = (SupplyMillivolts >= 5000)>
+	struct DS1302Limits
 	{
-		Read	= 0b0000'0001,
-		Write	= 0b0000'0000,
+		static constexpr uint32_t	kDataSetupNs	{ 200 };	// tDC
+		static constexpr uint32_t	kDataHoldNs		{ 280 };	// tCDH
+		static constexpr uint32_t	kDataDelayNs	{ 800 };	// tCDD (max)
+		static constexpr uint32_t	kClockLowNs		{ 1000 };	// tCL
+		static constexpr uint32_t	kClockHighNs	{ 1000 };	// tCH
+		static constexpr uint32_t	kClockPeriodNs	{ 2000 };	// 1 / fCLK (max 0.5 MHz)
+		static constexpr uint32_t	kCeSetupNs		{ 4000 };	// tCC
+		static constexpr uint32_t	kCeHoldNs		{ 240 };	// tCCH
+		static constexpr uint32_t	kCeInactiveNs	{ 4000 };	// tCWH
 	};
 
-	enum class Storage: uint8_t
+
+template<uint16_t SupplyMillivolts>
+	struct DS1302Limits<SupplyMillivolts, true>
 	{
-		RAM		= 0b0100'0000,
-		Clock	= 0b0000'0000,
+		static constexpr uint32_t	kDataSetupNs	{ 50 };
+		static constexpr uint32_t	kDataHoldNs		{ 70 };
+		static constexpr uint32_t	kDataDelayNs	{ 200 };
+		static constexpr uint32_t	kClockLowNs		{ 250 };
+		static constexpr uint32_t	kClockHighNs	{ 250 };
+		static constexpr uint32_t	kClockPeriodNs	{ 500 };	// 1 / fCLK (max 2 MHz)
+		static constexpr uint32_t	kCeSetupNs		{ 1000 };
+		static constexpr uint32_t	kCeHoldNs		{ 60 };
+		static constexpr uint32_t	kCeInactiveNs	{ 1000 };
 	};
 
-	enum class Register: uint8_t
+
+/**
+ * Return number of CPU cycles (rounded up) lasting at least given number of nanoseconds.
+ */
+constexpr uint32_t
+ns_to_cycles (uint32_t ns)
+{
+	return (ns * (F_CPU / 1000UL) + 999'999UL) / 1'000'000UL;
+}
+
+
+/**
+ * DS1302 bit-bang timing profile. Values are in nanoseconds and are checked
+ * against datasheet limits for given supply voltage. Delays in CPU cycles
+ * are computed from F_CPU.
+ *
+ * Delay before the rising clock edge covers both data setup time and the rest
+ * of clock low time (the part not already spent waiting for the data output
+ * after the falling edge).
+ */
+template<uint16_t pSupplyMillivolts,
+		 uint32_t pDataSetupNs, uint32_t pDataHoldNs, uint32_t pDataDelayNs,
+		 uint32_t pClockLowNs, uint32_t pClockHighNs,
+		 uint32_t pCeSetupNs, uint32_t pCeHoldNs, uint32_t pCeInactiveNs>
+	struct RTCTiming
 	{
-		Seconds			= rtc_write_byte_to_reg (0x80),
-		Minutes			= rtc_write_byte_to_reg (0x82),
-		Hours			= rtc_write_byte_to_reg (0x84),
-		DayOfMonth		= rtc_write_byte_to_reg (0x86),
-		Month			= rtc_write_byte_to_reg (0x88),
-		DayOfWeek		= rtc_write_byte_to_reg (0x8a),
-		Year			= rtc_write_byte_to_reg (0x8c),
-		Control			= rtc_write_byte_to_reg (0x8e),
-		TrickleCharger	= rtc_write_byte_to_reg (0x90),
+		using Limits = DS1302Limits<pSupplyMillivolts>;
+
+		static_assert (pSupplyMillivolts >= 2000, "DS1302 is not specified below 2.0 V");
+		static_assert (pDataSetupNs >= Limits::kDataSetupNs, "data setup time (tDC) too short");
+		static_assert (pDataHoldNs >= Limits::kDataHoldNs, "data hold time (tCDH) too short");
+		static_assert (pDataDelayNs >= Limits::kDataDelayNs, "wait for data output (tCDD) too short");
+		static_assert (pClockLowNs >= Limits::kClockLowNs, "clock low time (tCL) too short");
+		static_assert (pClockHighNs >= Limits::kClockHighNs, "clock high time (tCH) too short");
+		static_assert (pClockHighNs >= pDataHoldNs, "clock high time must cover data hold time");
+		static_assert (pClockLowNs + pClockHighNs >= Limits::kClockPeriodNs, "clock frequency (fCLK) too high");
+		static_assert (pCeSetupNs >= Limits::kCeSetupNs, "CE to clock setup time (tCC) too short");
+		static_assert (pCeHoldNs >= Limits::kCeHoldNs, "clock to CE hold time (tCCH) too short");
+		static_assert (pCeInactiveNs >= Limits::kCeInactiveNs, "CE inactive time (tCWH) too short");
+
+		static constexpr uint32_t	kClockLowCycles		{ ns_to_cycles (pClockLowNs > pDataDelayNs + pDataSetupNs
+																			? pClockLowNs - pDataDelayNs
+																			: pDataSetupNs) };
+		static constexpr uint32_t	kClockHighCycles	{ ns_to_cycles (pClockHighNs) };
+		static constexpr uint32_t	kDataDelayCycles	{ ns_to_cycles (pDataDelayNs) };
+		static constexpr uint32_t	kCeSetupCycles		{ ns_to_cycles (pCeSetupNs) };
+		static constexpr uint32_t	kCeHoldCycles		{ ns_to_cycles (pCeHoldNs) };
+		static constexpr uint32_t	kCeInactiveCycles	{ ns_to_cycles (pCeInactiveNs) };
 	};
 
-  public:
-	// Ctor
-	RTC();
 
-	Time
-	get_time() const;
+/**
+ * Worst-case profile, valid for any supply voltage from 2.0 V up.
+ */
+using RTCTimingWorstCase = RTCTiming<2000, 200, 280, 800, 1000, 1000, 4000, 240, 4000>;
 
-	void
-	set_time (Time const&);
+/**
+ * Fast profile for 5 V supply.
+ */
+using RTCTimingFast5V = RTCTiming<5000, 50, 70, 200, 250, 250, 1000, 60, 1000>;
 
-	uint8_t
-	get_seconds() const;
+/**
+ * Custom profile: 5 V limits with 100% margin, for long wires or slow edges.
+ * Replace values as needed, they're checked against the datasheet limits.
+ */
+using RTCTimingCustom = RTCTiming<5000, 100, 140, 400, 500, 500, 2000, 120, 2000>;
+
+#if defined(RTC_TIMING_CUSTOM)
+using DefaultRTCTiming = RTCTimingCustom;
+#elif SUPPLY_MILLIVOLTS >= 5000
+using DefaultRTCTiming = RTCTimingFast5V;
+#else
+using DefaultRTCTiming = RTCTimingWorstCase;
+#endif
 
-	void
-	set_seconds (uint8_t);
 
-	uint8_t
-	get_minutes() const;
+/**
+ * Support for DS1302 RTC clock.
+ * Timing is the bit-bang timing profile, see RTCTiming.
+ */
+template<class pTiming>
+	class BasicRTC
+	{
+		template<class>
+			friend class BasicRTCTransaction;
 
-	void
-	set_minutes (uint8_t);
+	  public:
+		using Timing = pTiming;
 
-	uint8_t
-	get_hours() const;
+	  private:
+		static constexpr MCU::Pin	_rtc_sclk		{ MCU::port_d.pin (1) };
+		static constexpr MCU::Pin	_rtc_io			{ MCU::port_d.pin (2) };
+		static constexpr MCU::Pin	_rtc_ce			{ MCU::port_d.pin (3) };
 
-	void
-	set_hours (uint8_t);
+		enum class Direction: uint8_t
+		{
+			Read	= 0b0000'0001,
+			Write	= 0b0000'0000,
+		};
 
-	uint8_t
-	get_day_of_month() const;
+		enum class Storage: uint8_t
+		{
+			RAM		= 0b0100'0000,
+			Clock	= 0b0000'0000,
+		};
 
-	uint8_t
-	get_month() const;
+		enum class Register: uint8_t
+		{
+			Seconds			= rtc_write_byte_to_reg (0x80),
+			Minutes			= rtc_write_byte_to_reg (0x82),
+			Hours			= rtc_write_byte_to_reg (0x84),
+			DayOfMonth		= rtc_write_byte_to_reg (0x86),
+			Month			= rtc_write_byte_to_reg (0x88),
+			DayOfWeek		= rtc_write_byte_to_reg (0x8a),
+			Year			= rtc_write_byte_to_reg (0x8c),
+			Control			= rtc_write_byte_to_reg (0x8e),
+			TrickleCharger	= rtc_write_byte_to_reg (0x90),
+			ClockBurst		= rtc_write_byte_to_reg (0xbe),
+		};
+
+		// Number of registers transferred in clock burst mode (seconds…control):
+		static constexpr uint8_t	kClockBurstSize	{ 8 };
+		// Masks for BCD value bits in time registers (other bits are control flags):
+		static constexpr uint8_t	kSecondsMask	{ 0b0111'1111 };
+		static constexpr uint8_t	kMinutesMask	{ 0b0111'1111 };
+		static constexpr uint8_t	kHoursMask		{ 0b0011'1111 };
+
+	  public:
+		// Ctor
+		BasicRTC();
+
+		/**
+		 * Read time using a single burst transaction,
+		 * so the result is never torn across a rollover.
+		 */
+		Time
+		get_time() const;
+
+		/**
+		 * Set time using a single burst transaction.
+		 * The clock is halted during the write, then restarted.
+		 */
+		void
+		set_time (Time const&);
+
+		/*
+		 * Time register accessors use packed BCD, like Time does.
+		 */
+
+		uint8_t
+		get_seconds() const;
+
+		void
+		set_seconds (uint8_t);
+
+		uint8_t
+		get_minutes() const;
+
+		void
+		set_minutes (uint8_t);
+
+		uint8_t
+		get_hours() const;
+
+		void
+		set_hours (uint8_t);
+
+		uint8_t
+		get_day_of_month() const;
+
+		uint8_t
+		get_month() const;
+
+		uint8_t
+		get_day_of_week() const;
+
+		uint8_t
+		get_year() const;
+
+	  private:
+		uint8_t
+		read_register (Register) const;
+
+		void
+		write_register (Register, uint8_t value);
+
+		/**
+		 * Read all clock registers in one CE-framed transaction.
+		 */
+		void
+		read_clock_burst (uint8_t (&registers)[kClockBurstSize]) const;
+
+		/**
+		 * Write all clock registers in one CE-framed transaction.
+		 */
+		void
+		write_clock_burst (uint8_t const (&registers)[kClockBurstSize]);
+
+		void
+		open_channel() const;
+
+		void
+		close_channel() const;
+
+		void
+		send_bytes (uint8_t const* bytes, uint8_t count);
+
+		/**
+		 * Send read command. Leaves IO line configured as input.
+		 */
+		void
+		send_command (uint8_t) const;
+
+		/**
+		 * Receive next byte after send_command().
+		 */
+		uint8_t
+		receive_byte() const;
+
+		uint8_t
+		make_command (Direction, Storage, Register) const;
+
+		void
+		clk (bool level) const;
 
-	uint8_t
-	get_day_of_week() const;
+		/**
+		 * Busy-wait given number of CPU cycles.
+		 */
+		template<uint32_t Cycles>
+			static void
+			delay();
+	};
 
-	uint8_t
-	get_year() const;
 
-  private:
-	uint8_t
-	read_register (Register) const;
+template<class T>
+	BasicRTC<T>::BasicRTC()
+	{
+		_rtc_sclk = false;
+		_rtc_io = false;
+		_rtc_ce = false;
+
+		_rtc_sclk.configure_as_output();
+		_rtc_io.configure_as_input();
+		_rtc_ce.configure_as_output();
+
+		// Make sure writes are enabled (write-protect bit off):
+		write_register (Register::Control, 0b0000'0000);
+
+		// Start the clock:
+		uint8_t seconds = read_register (Register::Seconds);
+		clear_bit (seconds, 7); // Bit 7 of the seconds register is Clock-Halt flag.
+		write_register (Register::Seconds, seconds);
+
+		// Use 24-hour format:
+		uint8_t hours = read_register (Register::Hours);
+		clear_bit (hours, 7);
+		write_register (Register::Hours, hours);
+	}
 
-	void
-	write_register (Register, uint8_t value);
 
-	void
-	open_channel() const;
+template<class T>
+	Time
+	BasicRTC<T>::get_time() const
+	{
+		uint8_t registers[kClockBurstSize];
+		read_clock_burst (registers);
+
+		// Registers are packed BCD, just mask out control bits:
+		return Time {
+			static_cast<uint8_t> (registers[2] & kHoursMask),
+			static_cast<uint8_t> (registers[1] & kMinutesMask),
+			static_cast<uint8_t> (registers[0] & kSecondsMask),
+		};
+	}
 
-	void
-	close_channel() const;
 
+template<class T>
 	void
-	send_bytes (uint8_t, uint8_t);
+	BasicRTC<T>::set_time (Time const& time)
+	{
+		// Keep the date registers:
+		uint8_t registers[kClockBurstSize];
+		read_clock_burst (registers);
+
+		// Bit 7 of the seconds register is Clock-Halt flag.
+		// Hours bit 7 cleared selects 24-hour format, control register 0 disables write-protection.
+		registers[0] = time.seconds | 0b1000'0000;
+		registers[1] = time.minutes;
+		registers[2] = time.hours;
+		registers[7] = 0b0000'0000;
+		write_clock_burst (registers);
+
+		// Restart the clock:
+		write_register (Register::Seconds, time.seconds);
+	}
 
-	uint8_t
-	send_receive_byte (uint8_t) const;
 
+template<class T>
 	uint8_t
-	make_command (Direction, Storage, Register) const;
+	BasicRTC<T>::get_seconds() const
+	{
+		return read_register (Register::Seconds) & kSecondsMask;
+	}
+
 
+template<class T>
 	void
-	clk (bool level) const;
-};
+	BasicRTC<T>::set_seconds (uint8_t seconds)
+	{
+		write_register (Register::Seconds, seconds);
+	}
 
 
-RTC::RTC()
-{
-	_rtc_sclk = false;
-	_rtc_io = false;
-	_rtc_ce = false;
-
-	_rtc_sclk.configure_as_output();
-	_rtc_io.configure_as_input();
-	_rtc_ce.configure_as_output();
-
-	// Make sure writes are enabled (write-protect bit off):
-	write_register (Register::Control, 0b0000'0000);
-
-	// Start the clock:
-	uint8_t seconds = read_register (Register::Seconds);
-	clear_bit (seconds, 7); // Bit 7 of the seconds register is Clock-Halt flag.
-	write_register (Register::Seconds, seconds);
-
-	// Use 24-hour format:
-	uint8_t hours = read_register (Register::Hours);
-	clear_bit (hours, 7);
-	write_register (Register::Hours, hours);
-}
+template<class T>
+	uint8_t
+	BasicRTC<T>::get_minutes() const
+	{
+		return read_register (Register::Minutes) & kMinutesMask;
+	}
 
 
-Time
-RTC::get_time() const
-{
-	return Time { get_hours(), get_minutes(), get_seconds() };
-}
+template<class T>
+	void
+	BasicRTC<T>::set_minutes (uint8_t minutes)
+	{
+		write_register (Register::Minutes, minutes);
+	}
 
 
-void
-RTC::set_time (Time const& time)
-{
-	set_hours (time.hours);
-	set_minutes (time.minutes);
-	set_seconds (time.seconds);
-}
+template<class T>
+	uint8_t
+	BasicRTC<T>::get_hours() const
+	{
+		return read_register (Register::Hours) & kHoursMask;
+	}
 
 
-uint8_t
-RTC::get_seconds() const
-{
-	uint8_t val = read_register (Register::Seconds);
-	return ((val & 0b0111'0000) >> 4) * 10 + (val & 0b1111);
-}
+template<class T>
+	void
+	BasicRTC<T>::set_hours (uint8_t hours)
+	{
+		write_register (Register::Hours, hours);
+	}
 
 
-void
-RTC::set_seconds (uint8_t seconds)
-{
-	uint8_t val = (seconds % 10) | (static_cast<uint8_t> (seconds / 10) << 4);
-	write_register (Register::Seconds, val);
-}
+template<class T>
+	uint8_t
+	BasicRTC<T>::get_day_of_month() const
+	{
+		uint8_t val = read_register (Register::DayOfMonth);
+		return ((val & 0b0011'0000) >> 4) * 10 + (val & 0b1111);
+	}
 
 
-uint8_t
-RTC::get_minutes() const
-{
-	uint8_t val = read_register (Register::Minutes);
-	return ((val & 0b0111'0000) >> 4) * 10 + (val & 0b1111);
-}
+template<class T>
+	uint8_t
+	BasicRTC<T>::get_month() const
+	{
+		uint8_t val = read_register (Register::Month);
+		return ((val & 0b0001'0000) >> 4) * 10 + (val & 0b1111);
+	}
 
 
-void
-RTC::set_minutes (uint8_t minutes)
-{
-	uint8_t val = (minutes % 10) | (static_cast<uint8_t> (minutes / 10) << 4);
-	write_register (Register::Minutes, val);
-}
+template<class T>
+	uint8_t
+	BasicRTC<T>::get_day_of_week() const
+	{
+		uint8_t val = read_register (Register::DayOfWeek);
+		return val & 0b111;
+	}
 
 
-uint8_t
-RTC::get_hours() const
-{
-	uint8_t val = read_register (Register::Hours);
-	return ((val & 0b0011'0000) >> 4) * 10 + (val & 0b1111);
-}
+template<class T>
+	uint8_t
+	BasicRTC<T>::get_year() const
+	{
+		uint8_t val = read_register (Register::DayOfWeek);
+		uint16_t year = ((val & 0b1111'0000) >> 4) * 10 + (val & 0b1111);
+		return year + 2000;
+	}
 
 
-void
-RTC::set_hours (uint8_t hours)
-{
-	uint8_t val = (hours % 10) | (static_cast<uint8_t> (hours / 10) << 4);
-	write_register (Register::Hours, val);
-}
+template<class T>
+	inline uint8_t
+	BasicRTC<T>::read_register (Register reg) const
+	{
+		open_channel();
+		send_command (make_command (Direction::Read, Storage::Clock, reg));
+		uint8_t data = receive_byte();
+		close_channel();
+		return data;
+	}
 
 
-uint8_t
-RTC::get_day_of_month() const
-{
-	uint8_t val = read_register (Register::DayOfMonth);
-	return ((val & 0b0011'0000) >> 4) * 10 + (val & 0b1111);
-}
+template<class T>
+	inline void
+	BasicRTC<T>::write_register (Register reg, uint8_t value)
+	{
+		uint8_t bytes[2] = { make_command (Direction::Write, Storage::Clock, reg), value };
 
+		open_channel();
+		send_bytes (bytes, 2);
+		close_channel();
+	}
 
-uint8_t
-RTC::get_month() const
-{
-	uint8_t val = read_register (Register::Month);
-	return ((val & 0b0001'0000) >> 4) * 10 + (val & 0b1111);
-}
 
+template<class T>
+	void
+	BasicRTC<T>::read_clock_burst (uint8_t (&registers)[kClockBurstSize]) const
+	{
+		open_channel();
+		send_command (make_command (Direction::Read, Storage::Clock, Register::ClockBurst));
 
-uint8_t
-RTC::get_day_of_week() const
-{
-	uint8_t val = read_register (Register::DayOfWeek);
-	return val & 0b111;
-}
+		for (auto& r: registers)
+			r = receive_byte();
 
+		close_channel();
+	}
 
-uint8_t
-RTC::get_year() const
-{
-	uint8_t val = read_register (Register::DayOfWeek);
-	uint16_t year = ((val & 0b1111'0000) >> 4) * 10 + (val & 0b1111);
-	return year + 2000;
-}
 
+template<class T>
+	void
+	BasicRTC<T>::write_clock_burst (uint8_t const (&registers)[kClockBurstSize])
+	{
+		uint8_t bytes[1 + kClockBurstSize];
+		bytes[0] = make_command (Direction::Write, Storage::Clock, Register::ClockBurst);
 
-inline uint8_t
-RTC::read_register (Register reg) const
-{
-	open_channel();
-	uint8_t data = send_receive_byte (make_command (Direction::Read, Storage::Clock, reg));
-	close_channel();
-	return data;
-}
+		for (uint8_t i = 0; i < kClockBurstSize; ++i)
+			bytes[1 + i] = registers[i];
 
+		open_channel();
+		send_bytes (bytes, sizeof (bytes));
+		close_channel();
+	}
 
-inline void
-RTC::write_register (Register reg, uint8_t value)
-{
-	open_channel();
-	send_bytes (make_command (Direction::Write, Storage::Clock, reg), value);
-	close_channel();
-}
+
+template<class T>
+	inline void
+	BasicRTC<T>::open_channel() const
+	{
+		_rtc_ce = true;
+		delay<Timing::kCeSetupCycles>();
+	}
 
 
-inline void
-RTC::open_channel() const
-{
-	_rtc_ce = true;
-	MCU::sleep_us<1>();
-}
+template<class T>
+	inline void
+	BasicRTC<T>::close_channel() const
+	{
+		delay<Timing::kCeHoldCycles>();
+		_rtc_ce = false;
+		delay<Timing::kCeInactiveCycles>();
+	}
 
 
-inline void
-RTC::close_channel() const
-{
-	_rtc_ce = false;
-	MCU::sleep_us<1>();
-}
+template<class T>
+	void
+	BasicRTC<T>::send_bytes (uint8_t const* bytes, uint8_t count)
+	{
+		_rtc_io.configure_as_output();
 
+		for (uint8_t i = 0; i < count; ++i)
+		{
+			uint8_t byte = bytes[i];
+
+			for (uint8_t b = 0; b < 8; ++b)
+			{
+				_rtc_io = !!((byte >> b) & 1);
+				clk (true);
+				clk (false);
+			}
+		}
 
-void
-RTC::send_bytes (uint8_t byte1, uint8_t byte2)
-{
-	_rtc_io.configure_as_output();
+		_rtc_io = false;
+		_rtc_io.configure_as_input();
+	}
 
-	uint8_t bytes[2] = { byte1, byte2 };
 
-	for (size_t i = 0; i < 2; ++i)
+template<class T>
+	void
+	BasicRTC<T>::send_command (uint8_t byte) const
 	{
-		uint8_t byte = bytes[i];
+		_rtc_io.configure_as_output();
 
+		// Send on 8 rising edges, receive on following falling edges.
 		for (uint8_t b = 0; b < 8; ++b)
 		{
+			clk (false);
 			_rtc_io = !!((byte >> b) & 1);
 			clk (true);
-			clk (false);
 		}
+
+		// Release the IO line before the falling edge that makes the chip output first bit:
+		_rtc_io = false;
+		_rtc_io.configure_as_input();
 	}
 
-	_rtc_io = false;
-	_rtc_io.configure_as_input();
-}
 
+template<class T>
+	uint8_t
+	BasicRTC<T>::receive_byte() const
+	{
+		uint8_t result = 0;
 
-uint8_t
-RTC::send_receive_byte (uint8_t byte) const
-{
-	_rtc_io.configure_as_output();
+		// Bits are shifted out on falling edges. In burst mode the chip
+		// continues with the next register on each subsequent 8 edges.
+		for (uint8_t b = 0; b < 8; ++b)
+		{
+			clk (true);
+			clk (false);
+			result |= _rtc_io.get() << b;
+		}
+
+		return result;
+	}
 
-	uint8_t result = 0;
 
-	// Send on 8 rising edges, receive on 8 falling edges.
-	for (uint8_t b = 0; b < 8; ++b)
+template<class T>
+	uint8_t
+	BasicRTC<T>::make_command (Direction direction, Storage storage, Register reg) const
 	{
-		clk (false);
-		_rtc_io = !!((byte >> b) & 1);
-		clk (true);
+		uint8_t data = static_cast<uint8_t> (reg);
+		data = data << 1;
+		data |= 0b1000'0000;
+		data |= static_cast<uint8_t> (storage);
+		data |= static_cast<uint8_t> (direction);
+		return data;
 	}
 
-	_rtc_io = false;
-	_rtc_io.configure_as_input();
 
-	for (uint8_t b = 0; b < 8; ++b)
+template<class T>
+	inline void
+	BasicRTC<T>::clk (bool level) const
 	{
-		clk (true);
-		clk (false);
-		result |= _rtc_io.get() << b;
+		if (level)
+		{
+			// Data has been set up and the clock has been low for long enough:
+			delay<Timing::kClockLowCycles>();
+			_rtc_sclk = true;
+		}
+		else
+		{
+			// Clock high time also covers data hold time after rising edge:
+			delay<Timing::kClockHighCycles>();
+			_rtc_sclk = false;
+			// Wait until data output by the chip on the falling edge is valid:
+			delay<Timing::kDataDelayCycles>();
+		}
 	}
 
-	return result;
-}
 
-
-uint8_t
-RTC::make_command (Direction direction, Storage storage, Register reg) const
-{
-	uint8_t data = static_cast<uint8_t> (reg);
-	data = data << 1;
-	data |= 0b1000'0000;
-	data |= static_cast<uint8_t> (storage);
-	data |= static_cast<uint8_t> (direction);
-	return data;
-}
+template<class T>
+	template<uint32_t Cycles>
+		inline void
+		BasicRTC<T>::delay()
+		{
+			if (Cycles > 0)
+				__builtin_avr_delay_cycles (Cycles);
+		}
 
 
-void
-RTC::clk (bool level) const
-{
-	MCU::sleep_us<5>(); // <1>
-	_rtc_sclk = level;
-	MCU::sleep_us<10>(); // <4>
-}
+using RTC = BasicRTC<DefaultRTCTiming>;
 
 #endif
 
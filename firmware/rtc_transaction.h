@@ -0,0 +1,348 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__RTC_TRANSACTION__INCLUDED
+#define CLOCK_1337__RTC_TRANSACTION__INCLUDED
+
+/**
+ * Non-blocking DS1302 read transaction.
+ *
+ * Each call to step() advances the transaction by a single clock edge,
+ * so the caller can interleave it with other work. DS1302 is a static
+ * device (clock frequency may go down to DC), so long pauses between
+ * steps are fine; only minimum timings from the RTC timing profile are
+ * enforced within each step.
+ *
+ * Must not be used at the same time as blocking RTC methods,
+ * call abort() before using them.
+ */
+template<class pRTC>
+	class BasicRTCTransaction
+	{
+	  public:
+		using RTC		= pRTC;
+		using Callback	= void (*)(void* context);
+
+	  private:
+		using Register	= typename RTC::Register;
+
+		enum class Phase: uint8_t
+		{
+			Idle,
+			// Sending command byte:
+			Command,
+			// Receiving data bytes:
+			Data,
+			// Releasing the chip:
+			Finish,
+		};
+
+	  public:
+		// Ctor
+		explicit
+		BasicRTCTransaction (RTC&);
+
+		/**
+		 * Start reading the seconds register.
+		 */
+		void
+		start_read_seconds();
+
+		/**
+		 * Start reading time with the clock burst command.
+		 * On success, last_good_time() gets updated.
+		 */
+		void
+		start_read_time();
+
+		/**
+		 * Advance the transaction by one clock edge.
+		 * Return true if the transaction has completed in this step.
+		 */
+		bool
+		step();
+
+		/**
+		 * Cancel current transaction, forget the last result and release the chip.
+		 */
+		void
+		abort();
+
+		/**
+		 * Return true if a transaction is in progress.
+		 */
+		bool
+		busy() const;
+
+		/**
+		 * Return true if the last transaction has completed and returned valid data.
+		 * Cleared when new transaction is started.
+		 */
+		bool
+		succeeded() const;
+
+		/**
+		 * Return seconds (packed BCD) read by the last successful transaction.
+		 */
+		uint8_t
+		seconds() const;
+
+		/**
+		 * Return time read by the last successful burst transaction.
+		 */
+		Time
+		last_good_time() const;
+
+		/**
+		 * Set function to be called when a transaction completes (successfully or not).
+		 */
+		void
+		set_callback (Callback, void* context);
+
+	  private:
+		void
+		start (Register, uint8_t bytes_count);
+
+		void
+		finish();
+
+	  private:
+		RTC&		_rtc;
+		Phase		_phase				{ Phase::Idle };
+		uint8_t		_command			{ 0 };
+		uint8_t		_bytes_count		{ 0 };
+		uint8_t		_byte				{ 0 };
+		uint8_t		_bit				{ 0 };
+		bool		_clock_high			{ false };
+		bool		_succeeded			{ false };
+		uint8_t		_buffer[RTC::kClockBurstSize];
+		uint8_t		_seconds			{ 0 };
+		Time		_last_good_time;
+		Callback	_callback			{ nullptr };
+		void*		_callback_context	{ nullptr };
+	};
+
+
+template<class R>
+	inline
+	BasicRTCTransaction<R>::BasicRTCTransaction (RTC& rtc):
+		_rtc (rtc)
+	{ }
+
+
+template<class R>
+	inline void
+	BasicRTCTransaction<R>::start_read_seconds()
+	{
+		start (Register::Seconds, 1);
+	}
+
+
+template<class R>
+	inline void
+	BasicRTCTransaction<R>::start_read_time()
+	{
+		start (Register::ClockBurst, RTC::kClockBurstSize);
+	}
+
+
+template<class R>
+	bool
+	BasicRTCTransaction<R>::step()
+	{
+		using Timing = typename RTC::Timing;
+
+		switch (_phase)
+		{
+			case Phase::Idle:
+				break;
+
+			case Phase::Command:
+				if (!_clock_high)
+				{
+					// Chip latches data on rising edges:
+					RTC::_rtc_io = !!((_command >> _bit) & 1);
+					RTC::template delay<Timing::kClockLowCycles>();
+					RTC::_rtc_sclk = true;
+					_clock_high = true;
+				}
+				else if (_bit < 7)
+				{
+					RTC::template delay<Timing::kClockHighCycles>();
+					RTC::_rtc_sclk = false;
+					_clock_high = false;
+					_bit++;
+				}
+				else
+				{
+					// Release the IO line before the falling edge that makes the chip output first bit:
+					RTC::_rtc_io = false;
+					RTC::_rtc_io.configure_as_input();
+					_phase = Phase::Data;
+					_bit = 0;
+				}
+				break;
+
+			case Phase::Data:
+				if (_clock_high)
+				{
+					RTC::template delay<Timing::kClockHighCycles>();
+					RTC::_rtc_sclk = false;
+					_clock_high = false;
+					RTC::template delay<Timing::kDataDelayCycles>();
+
+					if (RTC::_rtc_io.get())
+						_buffer[_byte] |= 1 << _bit;
+
+					if (++_bit == 8)
+					{
+						_bit = 0;
+
+						if (++_byte == _bytes_count)
+							_phase = Phase::Finish;
+					}
+				}
+				else
+				{
+					RTC::template delay<Timing::kClockLowCycles>();
+					RTC::_rtc_sclk = true;
+					_clock_high = true;
+				}
+				break;
+
+			case Phase::Finish:
+				finish();
+				return true;
+		}
+
+		return false;
+	}
+
+
+template<class R>
+	void
+	BasicRTCTransaction<R>::abort()
+	{
+		_succeeded = false;
+
+		if (_phase != Phase::Idle)
+		{
+			RTC::_rtc_sclk = false;
+			RTC::_rtc_io = false;
+			RTC::_rtc_io.configure_as_input();
+			_rtc.close_channel();
+			_phase = Phase::Idle;
+		}
+	}
+
+
+template<class R>
+	inline bool
+	BasicRTCTransaction<R>::busy() const
+	{
+		return _phase != Phase::Idle;
+	}
+
+
+template<class R>
+	inline bool
+	BasicRTCTransaction<R>::succeeded() const
+	{
+		return _succeeded;
+	}
+
+
+template<class R>
+	inline uint8_t
+	BasicRTCTransaction<R>::seconds() const
+	{
+		return _seconds;
+	}
+
+
+template<class R>
+	inline Time
+	BasicRTCTransaction<R>::last_good_time() const
+	{
+		return _last_good_time;
+	}
+
+
+template<class R>
+	inline void
+	BasicRTCTransaction<R>::set_callback (Callback callback, void* context)
+	{
+		_callback = callback;
+		_callback_context = context;
+	}
+
+
+template<class R>
+	void
+	BasicRTCTransaction<R>::start (Register reg, uint8_t bytes_count)
+	{
+		abort();
+
+		_command = _rtc.make_command (RTC::Direction::Read, RTC::Storage::Clock, reg);
+		_bytes_count = bytes_count;
+		_byte = 0;
+		_bit = 0;
+		_clock_high = false;
+		_succeeded = false;
+
+		for (auto& b: _buffer)
+			b = 0;
+
+		RTC::_rtc_sclk = false;
+		RTC::_rtc_io.configure_as_output();
+		_rtc.open_channel();
+		_phase = Phase::Command;
+	}
+
+
+template<class R>
+	void
+	BasicRTCTransaction<R>::finish()
+	{
+		_rtc.close_channel();
+		_phase = Phase::Idle;
+
+		// Seconds register with Clock-Halt bit set is not a valid time:
+		_succeeded = bcd::valid (_buffer[0], 0x59);
+
+		if (_bytes_count == RTC::kClockBurstSize)
+		{
+			Time const time {
+				static_cast<uint8_t> (_buffer[2] & RTC::kHoursMask),
+				static_cast<uint8_t> (_buffer[1] & RTC::kMinutesMask),
+				_buffer[0],
+			};
+
+			_succeeded = _succeeded && time.valid();
+
+			if (_succeeded)
+				_last_good_time = time;
+		}
+
+		if (_succeeded)
+			_seconds = _buffer[0];
+
+		if (_callback)
+			_callback (_callback_context);
+	}
+
+
+using RTCTransaction = BasicRTCTransaction<RTC>;
+
+#endif
+
@@ -0,0 +1,155 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__SCHEDULER__INCLUDED
+#define CLOCK_1337__SCHEDULER__INCLUDED
+
+/**
+ * Cooperative scheduler for periodic tasks.
+ *
+ * Each task is a method of the Owner object, run once per its period.
+ * Deadline of a task is the start of its next period; if a task couldn't be
+ * started before its deadline, it's counted as a missed deadline and the
+ * task is rescheduled relative to current time. Tasks running longer than
+ * their cost budget are counted as overruns.
+ */
+template<class pOwner, uint8_t pTasksCount>
+	class Scheduler
+	{
+	  public:
+		using Owner = pOwner;
+
+		static constexpr uint8_t kTasksCount = pTasksCount;
+
+		/**
+		 * Static task description.
+		 */
+		struct Task
+		{
+			void		(Owner::*handler)();
+			// Period in milliseconds, must be greater than 0:
+			uint16_t	period_ms;
+			// Expected maximum execution time in microseconds:
+			uint16_t	budget_us;
+		};
+
+		/**
+		 * Runtime statistics of a task.
+		 */
+		struct Statistics
+		{
+			uint16_t	runs				= 0;
+			uint16_t	overruns			= 0;
+			uint16_t	missed_deadlines	= 0;
+			uint16_t	max_cost_us			= 0;
+		};
+
+	  public:
+		// Ctor
+		Scheduler (Owner&, Task const (&tasks)[kTasksCount]);
+
+		/**
+		 * Start counting task periods from now.
+		 * SystemClock must be initialized first.
+		 */
+		void
+		start();
+
+		/**
+		 * Run all tasks that are due.
+		 * Call in loop.
+		 */
+		void
+		run();
+
+		/**
+		 * Return statistics of given task.
+		 */
+		Statistics const&
+		statistics (uint8_t task_index) const;
+
+	  private:
+		Owner&		_owner;
+		Task const*	_tasks;
+		uint16_t	_next_run_ms[kTasksCount]	= { };
+		Statistics	_statistics[kTasksCount];
+	};
+
+
+template<class O, uint8_t N>
+	inline
+	Scheduler<O, N>::Scheduler (Owner& owner, Task const (&tasks)[kTasksCount]):
+		_owner (owner),
+		_tasks (tasks)
+	{ }
+
+
+template<class O, uint8_t N>
+	void
+	Scheduler<O, N>::start()
+	{
+		uint16_t const now_ms = SystemClock::millis();
+
+		for (auto& next_run_ms: _next_run_ms)
+			next_run_ms = now_ms;
+	}
+
+
+template<class O, uint8_t N>
+	void
+	Scheduler<O, N>::run()
+	{
+		for (uint8_t i = 0; i < kTasksCount; ++i)
+		{
+			Task const& task = _tasks[i];
+			// 16-bit arithmetic is enough, as long as periods are shorter than ~32 s:
+			uint16_t const now_ms = SystemClock::millis();
+
+			if (static_cast<int16_t> (now_ms - _next_run_ms[i]) < 0)
+				continue;
+
+			_next_run_ms[i] += task.period_ms;
+
+			// If the task is late by more than a period, it missed its deadline.
+			// Don't try to catch up, start counting periods from now:
+			if (static_cast<int16_t> (now_ms - _next_run_ms[i]) >= 0)
+			{
+				_statistics[i].missed_deadlines++;
+				_next_run_ms[i] = now_ms + task.period_ms;
+			}
+
+			uint32_t const start_us = SystemClock::micros();
+			(_owner.*task.handler)();
+			uint32_t const cost_us = SystemClock::micros() - start_us;
+
+			Statistics& stats = _statistics[i];
+			stats.runs++;
+
+			if (cost_us > task.budget_us)
+				stats.overruns++;
+
+			if (cost_us > stats.max_cost_us)
+				stats.max_cost_us = cost_us > 0xffff ? 0xffff : cost_us;
+		}
+	}
+
+
+template<class O, uint8_t N>
+	inline auto
+	Scheduler<O, N>::statistics (uint8_t task_index) const -> Statistics const&
+	{
+		return _statistics[task_index];
+	}
+
+#endif
+
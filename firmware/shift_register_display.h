@@ -0,0 +1,368 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__SHIFT_REGISTER_DISPLAY__INCLUDED
+#define CLOCK_1337__SHIFT_REGISTER_DISPLAY__INCLUDED
+
+/**
+ * Pinout of a 1337 clock board with 74HC595-driven digits.
+ *
+ * Pinout description must provide kLatchPin (RCLK of all chips). Segment
+ * data goes over hardware SPI (MOSI = PB2, SCK = PB1), output-enable
+ * inputs of all chips are driven by OC0A (PB7).
+ */
+struct Clock1337ShiftRegisterPinout
+{
+	static constexpr MCU::Pin kLatchPin { MCU::port_b.pin (6) };
+};
+
+
+constexpr MCU::Pin Clock1337ShiftRegisterPinout::kLatchPin;
+
+
+/**
+ * 7-segment display driven statically by a chain of 74HC595 shift registers,
+ * one per digit, outputs QA…QG driving segments a…g and QH driving dp.
+ * Chip 0 (closest to the MCU) drives the leftmost digit.
+ *
+ * publish() hands a new frame over to the SPI interrupt, which shifts one
+ * byte per digit and pulses the latch once after the last one, so the picture
+ * changes atomically. If a frame is published while another one is being
+ * shifted out, it's sent right after, and only the newest one is kept.
+ *
+ * Since nothing is multiplexed, brightness is set with Timer0 fast PWM on
+ * the common output-enable line, updated together with the latch.
+ *
+ * Provides the same API as BasicDisplay, so it can be used by Clock unchanged.
+ */
+template<uint8_t pDigitsCount, class pPinout>
+	class ShiftRegisterDisplay: public BasicDisplayContent<pDigitsCount>
+	{
+		using Base = BasicDisplayContent<pDigitsCount>;
+		using Content = typename Base::Content;
+
+	  public:
+		using Pinout = pPinout;
+
+		using Base::kDigitsCount;
+
+		// SPI bytes needed to send a single frame:
+		static constexpr uint8_t	kFrameBytes			{ kDigitsCount };
+
+		// SPI clock is F_CPU / 2, that is 16 cycles per byte plus the interrupt:
+		static constexpr uint8_t	kCyclesPerByte		{ 16 };
+
+	  private:
+		using Base::kGammaBits;
+		using Base::kGammaTable;
+		using Base::_content;
+
+		// Inverted fast PWM on OC0A: pin is low (outputs enabled) for OCR0A + 1 ticks out of 256:
+		static constexpr uint8_t	kPwmMode			{ (1 << COM0A1) | (1 << COM0A0) | (1 << WGM01) | (1 << WGM00) };
+
+		// Output-enable pin (OC0A):
+		static constexpr MCU::Pin	kOutputEnablePin	{ MCU::port_b.pin (7) };
+		static constexpr MCU::Pin	kSlaveSelectPin		{ MCU::port_b.pin (0) };
+		static constexpr MCU::Pin	kClockPin			{ MCU::port_b.pin (1) };
+		static constexpr MCU::Pin	kDataPin			{ MCU::port_b.pin (2) };
+
+	  public:
+		/**
+		 * Kept for compatibility with BasicDisplay; there's no scanning interrupt.
+		 */
+		struct ScanStatistics
+		{
+			uint16_t	last_frame_us	= 0;
+			uint16_t	max_frame_us	= 0;
+		};
+
+	  private:
+		/**
+		 * Everything sent to the chips for one picture.
+		 */
+		struct Frame
+		{
+			// Segment bits for each digit, left to right:
+			uint8_t	segments[kDigitsCount];
+			// OCR0A value for the output-enable PWM:
+			uint8_t	compare;
+		};
+
+	  public:
+		/**
+		 * Starts with disabled display.
+		 */
+		ShiftRegisterDisplay();
+
+		/**
+		 * Make all changes done with set_*() methods visible on the display.
+		 * Doesn't wait for the transfer to finish.
+		 */
+		void
+		publish();
+
+		/**
+		 * Start SPI and brightness PWM. The display is driven statically, so RefreshRateHz
+		 * is only used as the lowest allowed PWM frequency.
+		 * Global interrupts must be enabled separately.
+		 */
+		template<uint16_t RefreshRateHz>
+			void
+			start_scanning();
+
+		/**
+		 * Always returns zeros.
+		 */
+		ScanStatistics
+		scan_statistics() const;
+
+		/**
+		 * Send next byte of the frame, or latch the frame after the last byte.
+		 * Called from the SPI interrupt.
+		 */
+		void
+		update();
+
+		/**
+		 * SPI transfer-complete interrupt handler.
+		 */
+		static void
+		handle_interrupt();
+
+	  private:
+		/**
+		 * Return frame for given content.
+		 */
+		static constexpr Frame
+		make_frame (Content const&);
+
+		/**
+		 * Return byte sent as index-th in the frame. The first byte ends up
+		 * in the last chip of the chain, so digits go right to left.
+		 */
+		static constexpr uint8_t
+		frame_byte (Frame const&, uint8_t index);
+
+		/**
+		 * Return Timer0 clock-select bits giving PWM frequency of at least given value.
+		 */
+		static constexpr uint8_t
+		pwm_clock_select (uint16_t min_frequency_hz);
+
+		/**
+		 * Start shifting out _next_frame. Must be called with interrupts disabled.
+		 */
+		void
+		start_transfer();
+
+	  private:
+		static ShiftRegisterDisplay*	_shifted_display;
+
+		// Written by publish() with interrupts disabled, read by the interrupt:
+		Frame				_next_frame			= { };
+		bool volatile		_frame_pending		= false;
+		// Used only by the interrupt (and by publish() when the transfer is idle):
+		Frame				_shifted_frame		= { };
+		bool volatile		_transfer_active	= false;
+		uint8_t				_byte_index			= 0;
+	};
+
+
+template<uint8_t N, class P>
+	constexpr MCU::Pin ShiftRegisterDisplay<N, P>::kOutputEnablePin;
+
+
+template<uint8_t N, class P>
+	constexpr MCU::Pin ShiftRegisterDisplay<N, P>::kSlaveSelectPin;
+
+
+template<uint8_t N, class P>
+	constexpr MCU::Pin ShiftRegisterDisplay<N, P>::kClockPin;
+
+
+template<uint8_t N, class P>
+	constexpr MCU::Pin ShiftRegisterDisplay<N, P>::kDataPin;
+
+
+template<uint8_t N, class P>
+	ShiftRegisterDisplay<N, P>* ShiftRegisterDisplay<N, P>::_shifted_display = nullptr;
+
+
+template<uint8_t N, class P>
+	ShiftRegisterDisplay<N, P>::ShiftRegisterDisplay()
+	{
+		// Outputs disabled until the first frame is latched:
+		kOutputEnablePin = true;
+		kOutputEnablePin.configure_as_output();
+		Pinout::kLatchPin = false;
+		Pinout::kLatchPin.configure_as_output();
+		// SS must be an output, or SPI master mode may be dropped:
+		kSlaveSelectPin.configure_as_output();
+		kClockPin = false;
+		kClockPin.configure_as_output();
+		kDataPin = false;
+		kDataPin.configure_as_output();
+	}
+
+
+template<uint8_t N, class P>
+	void
+	ShiftRegisterDisplay<N, P>::publish()
+	{
+		Frame const frame = make_frame (_content);
+
+		ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		{
+			_next_frame = frame;
+			_frame_pending = true;
+
+			if (_shifted_display && !_transfer_active)
+				start_transfer();
+		}
+	}
+
+
+template<uint8_t N, class P>
+	template<uint16_t RefreshRateHz>
+		inline void
+		ShiftRegisterDisplay<N, P>::start_scanning()
+		{
+			_shifted_display = this;
+
+			// Master, MSB first, mode 0 (595 samples on rising SCK), F_CPU / 2:
+			SPCR = (1 << SPIE) | (1 << SPE) | (1 << MSTR);
+			SPSR = 1 << SPI2X;
+
+			// Run the timer, but keep OC0A disconnected (outputs disabled) until the first frame is latched,
+			// chips power up with random contents:
+			TCCR0A = (1 << WGM01) | (1 << WGM00);
+			TCCR0B = pwm_clock_select (RefreshRateHz);
+
+			ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+			{
+				if (_frame_pending)
+					start_transfer();
+			}
+		}
+
+
+template<uint8_t N, class P>
+	inline auto
+	ShiftRegisterDisplay<N, P>::scan_statistics() const -> ScanStatistics
+	{
+		return ScanStatistics();
+	}
+
+
+template<uint8_t N, class P>
+	inline void
+	ShiftRegisterDisplay<N, P>::update()
+	{
+		if (++_byte_index < kFrameBytes)
+			SPDR = frame_byte (_shifted_frame, _byte_index);
+		else
+		{
+			// Both registers are updated on the rising edge of RCLK:
+			Pinout::kLatchPin = true;
+			Pinout::kLatchPin = false;
+			// Double-buffered by the timer, takes effect at the start of next PWM cycle:
+			OCR0A = _shifted_frame.compare;
+			TCCR0A = kPwmMode;
+
+			if (_frame_pending)
+				start_transfer();
+			else
+				_transfer_active = false;
+		}
+	}
+
+
+template<uint8_t N, class P>
+	inline void
+	ShiftRegisterDisplay<N, P>::handle_interrupt()
+	{
+		if (_shifted_display)
+			_shifted_display->update();
+	}
+
+
+template<uint8_t N, class P>
+	inline void
+	ShiftRegisterDisplay<N, P>::start_transfer()
+	{
+		_shifted_frame = _next_frame;
+		_frame_pending = false;
+		_transfer_active = true;
+		_byte_index = 0;
+		SPDR = frame_byte (_shifted_frame, 0);
+	}
+
+
+template<uint8_t N, class P>
+	constexpr auto
+	ShiftRegisterDisplay<N, P>::make_frame (Content const& content) -> Frame
+	{
+		Frame frame {};
+		uint8_t const duty = kGammaTable[content.brightness];
+
+		// Blank the outputs instead of disabling PWM, since the shortest PWM pulse isn't zero:
+		if (content.enabled && duty > 0)
+		{
+			for (uint8_t d = 0; d < kDigitsCount; ++d)
+				frame.segments[d] = Base::segments (content, d);
+
+			// Scale duty to full 8 bits:
+			frame.compare = static_cast<uint8_t> ((duty << (8 - kGammaBits)) | ((1 << (8 - kGammaBits)) - 1));
+		}
+
+		return frame;
+	}
+
+
+template<uint8_t N, class P>
+	constexpr uint8_t
+	ShiftRegisterDisplay<N, P>::frame_byte (Frame const& frame, uint8_t index)
+	{
+		return frame.segments[kDigitsCount - 1 - index];
+	}
+
+
+template<uint8_t N, class P>
+	constexpr uint8_t
+	ShiftRegisterDisplay<N, P>::pwm_clock_select (uint16_t min_frequency_hz)
+	{
+		// Fast PWM period is 256 timer ticks; prefer the slowest clock, fewer edges:
+		return F_CPU / 256 / 1024 >= min_frequency_hz ? 0b101
+			 : F_CPU / 256 / 256 >= min_frequency_hz ? 0b100
+			 : F_CPU / 256 / 64 >= min_frequency_hz ? 0b011
+			 : F_CPU / 256 / 8 >= min_frequency_hz ? 0b010
+			 : 0b001;
+	}
+
+
+#if DISPLAY_SHIFT_REGISTER
+
+using Display = ShiftRegisterDisplay<4, Clock1337ShiftRegisterPinout>;
+
+static_assert (1UL * Display::kFrameBytes * Display::kCyclesPerByte * 1000000UL / F_CPU < 100, "shift-register frame takes too long to send");
+
+
+ISR (SPI_STC_vect)
+{
+	Display::handle_interrupt();
+}
+
+#endif
+
+#endif
+
@@ -0,0 +1,119 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__SPSC_QUEUE__INCLUDED
+#define CLOCK_1337__SPSC_QUEUE__INCLUDED
+
+/**
+ * Single-producer, single-consumer ring buffer, typically an interrupt
+ * handler on one side and the main loop on the other.
+ *
+ * Head is written only by the producer, tail only by the consumer, both are
+ * single bytes, so neither side needs to disable interrupts. A slot is
+ * written before head is advanced past it and read before tail is advanced
+ * past it, so the other side never sees a half-written value.
+ *
+ * One slot is always left empty to tell full from empty, so the queue holds
+ * up to pSize - 1 values.
+ */
+template<class pValue, uint8_t pSize>
+	class SPSCQueue
+	{
+		static_assert (pSize >= 2 && (pSize & (pSize - 1)) == 0, "queue size must be a power of 2");
+
+		static constexpr uint8_t kIndexMask { pSize - 1 };
+
+	  public:
+		using Value = pValue;
+
+	  public:
+		/**
+		 * Add value to the queue. Producer side only.
+		 * Return false (and count the value as dropped) if the queue is full.
+		 */
+		bool
+		push (Value const&);
+
+		/**
+		 * Take the oldest value from the queue. Consumer side only.
+		 * Return false if the queue is empty.
+		 */
+		bool
+		pop (Value&);
+
+		/**
+		 * Return number of values dropped because the queue was full.
+		 */
+		uint8_t
+		dropped() const;
+
+	  private:
+		Value				_values[pSize];
+		uint8_t volatile	_head		= 0;
+		uint8_t volatile	_tail		= 0;
+		// Written by the producer only:
+		uint8_t volatile	_dropped	= 0;
+	};
+
+
+template<class V, uint8_t S>
+	inline bool
+	SPSCQueue<V, S>::push (Value const& value)
+	{
+		uint8_t const head = _head;
+		uint8_t const next_head = (head + 1) & kIndexMask;
+
+		if (next_head == _tail)
+		{
+			if (_dropped < 0xff)
+				_dropped = _dropped + 1;
+
+			return false;
+		}
+
+		_values[head] = value;
+		// Value must be complete before the consumer can see it:
+		asm volatile ("" ::: "memory");
+		_head = next_head;
+		return true;
+	}
+
+
+template<class V, uint8_t S>
+	inline bool
+	SPSCQueue<V, S>::pop (Value& value)
+	{
+		uint8_t const tail = _tail;
+
+		if (tail == _head)
+			return false;
+
+		// Head is read before the slot:
+		asm volatile ("" ::: "memory");
+		value = _values[tail];
+		// Slot must be read before the producer can reuse it:
+		asm volatile ("" ::: "memory");
+		_tail = (tail + 1) & kIndexMask;
+		return true;
+	}
+
+
+template<class V, uint8_t S>
+	inline uint8_t
+	SPSCQueue<V, S>::dropped() const
+	{
+		return _dropped;
+	}
+
+#endif
+
@@ -0,0 +1,161 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__SYSTEM_CLOCK__INCLUDED
+#define CLOCK_1337__SYSTEM_CLOCK__INCLUDED
+
+// System:
+#include <util/atomic.h>
+
+
+/**
+ * Monotonic system time source.
+ *
+ * Timer1 runs free with 1 µs resolution. Compare-match A interrupt is moved
+ * forward by 1 ms each time it fires, which gives millisecond tick without
+ * resetting the counter, so the counter itself can be used for precise
+ * timestamps.
+ */
+class SystemClock
+{
+	static_assert (F_CPU == 8000000L, "SystemClock expects 8 MHz clock (Timer1 prescaler 8 gives 1 µs ticks)");
+
+	static constexpr uint16_t	kTicksPerMillisecond	{ 1000 };
+
+  public:
+	/**
+	 * Configure and start Timer1.
+	 * Global interrupts must be enabled separately.
+	 */
+	static void
+	initialize();
+
+	/**
+	 * Return number of milliseconds since initialize().
+	 */
+	static uint32_t
+	millis();
+
+	/**
+	 * Return number of microseconds since initialize().
+	 * Wraps around every ~71 minutes, so use only for computing differences.
+	 */
+	static uint32_t
+	micros();
+
+	/**
+	 * Extend Timer1 value read or captured less than ~32 ms ago to microseconds
+	 * since initialize(), like micros(). Call with interrupts disabled.
+	 */
+	static uint32_t
+	timestamp (uint16_t counter);
+
+	/**
+	 * Timer1 compare-match A interrupt handler.
+	 */
+	static void
+	handle_millisecond_interrupt();
+
+	/**
+	 * Timer1 overflow interrupt handler.
+	 */
+	static void
+	handle_overflow_interrupt();
+
+  private:
+	static uint32_t volatile	_millis;
+	static uint16_t volatile	_overflows;
+};
+
+
+uint32_t volatile SystemClock::_millis = 0;
+uint16_t volatile SystemClock::_overflows = 0;
+
+
+ISR (TIMER1_COMPA_vect)
+{
+	SystemClock::handle_millisecond_interrupt();
+}
+
+
+ISR (TIMER1_OVF_vect)
+{
+	SystemClock::handle_overflow_interrupt();
+}
+
+
+void
+SystemClock::initialize()
+{
+	// Normal mode, prescaler 8:
+	TCCR1A = 0;
+	TCCR1B = 1 << CS11;
+	TCNT1 = 0;
+	OCR1A = kTicksPerMillisecond;
+	TIMSK1 |= (1 << OCIE1A) | (1 << TOIE1);
+}
+
+
+inline uint32_t
+SystemClock::millis()
+{
+	uint32_t result;
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		result = _millis;
+
+	return result;
+}
+
+
+inline uint32_t
+SystemClock::micros()
+{
+	uint32_t result;
+
+	ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+		result = timestamp (TCNT1);
+
+	return result;
+}
+
+
+inline uint32_t
+SystemClock::timestamp (uint16_t counter)
+{
+	uint16_t overflows = _overflows;
+
+	// Overflow that happened after interrupts were disabled is not counted yet:
+	if ((TIFR1 & (1 << TOV1)) && counter < 0x8000)
+		++overflows;
+
+	return (static_cast<uint32_t> (overflows) << 16) | counter;
+}
+
+
+inline void
+SystemClock::handle_millisecond_interrupt()
+{
+	OCR1A += kTicksPerMillisecond;
+	_millis = _millis + 1;
+}
+
+
+inline void
+SystemClock::handle_overflow_interrupt()
+{
+	_overflows = _overflows + 1;
+}
+
+#endif
+
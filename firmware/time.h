@@ -16,13 +16,16 @@
 
 /**
  * Time of day representation.
+ * All fields are packed BCD, the same as in the RTC registers,
+ * so time can go from the RTC to the display without conversions.
  */
 class Time
 {
   public:
-	uint8_t	hours		= 0;
-	uint8_t	minutes		= 0;
-	uint8_t	seconds		= 0;
+	// Packed BCD:
+	uint8_t	hours		= 0x00;
+	uint8_t	minutes		= 0x00;
+	uint8_t	seconds		= 0x00;
 
   public:
 	constexpr bool
@@ -31,11 +34,23 @@ class Time
 	constexpr bool
 	operator!= (Time const& other) const;
 
+	/**
+	 * Return true if all fields are valid BCD within their ranges.
+	 */
+	constexpr bool
+	valid() const;
+
+	/**
+	 * Return binary number of seconds since midnight.
+	 */
 	constexpr uint32_t
 	seconds_since_midnight() const;
 
+	/**
+	 * Advance by one second, wrapping around at midnight.
+	 */
 	constexpr void
-	update_modulo();
+	increment_seconds();
 
 	constexpr void
 	sanitize();
@@ -58,33 +73,42 @@ Time::operator!= (Time const& other) const
 }
 
 
+constexpr bool
+Time::valid() const
+{
+	return bcd::valid (hours, 0x23) &&
+		   bcd::valid (minutes, 0x59) &&
+		   bcd::valid (seconds, 0x59);
+}
+
+
 constexpr uint32_t
 Time::seconds_since_midnight() const
 {
-	return 1L * seconds + 60L * minutes + 3600L * hours;
+	return 1L * bcd::to_binary (seconds) + 60L * bcd::to_binary (minutes) + 3600L * bcd::to_binary (hours);
 }
 
 
 constexpr void
-Time::update_modulo()
+Time::increment_seconds()
 {
-	hours = hours % 24;
-	minutes = minutes % 60;
-	seconds = seconds % 60;
+	if (bcd::increment (seconds, 0x59))
+		if (bcd::increment (minutes, 0x59))
+			bcd::increment (hours, 0x23);
 }
 
 
 constexpr void
 Time::sanitize()
 {
-	if (hours > 23)
-		hours = 23;
+	if (!bcd::valid (hours, 0x23))
+		hours = 0x23;
 
-	if (minutes > 59)
-		minutes = 59;
+	if (!bcd::valid (minutes, 0x59))
+		minutes = 0x59;
 
-	if (seconds > 59)
-		seconds = 59;
+	if (!bcd::valid (seconds, 0x59))
+		seconds = 0x59;
 }
 
 #endif
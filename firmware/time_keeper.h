@@ -0,0 +1,529 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__TIME_KEEPER__INCLUDED
+#define CLOCK_1337__TIME_KEEPER__INCLUDED
+
+/**
+ * Keeps time of day locally using SystemClock and only occasionally
+ * synchronizes it with the RTC chip.
+ *
+ * Synchronization happens around the predicted second boundary: the RTC
+ * seconds register is polled until it changes, which gives timestamp of
+ * the RTC second edge. Polling uses non-blocking RTCTransaction, which
+ * must be stepped by the caller, so it doesn't stall anything else.
+ * An edge counts only if the poll right before it, in the same polling
+ * state, has seen the old second; otherwise its time is unknown.
+ * Difference between the RTC edge and the locally predicted one is the
+ * drift, used to trim length of the local second. Resync interval doubles
+ * as long as the drift stays small and goes back to minimum when it doesn't.
+ *
+ * Local second edges are phase-locked to the RTC ones, so the sub-second
+ * phase() can be used for blinking in sync with the displayed seconds,
+ * and next_edge_us() for scheduling things on the second edge. Each
+ * measured RTC edge is reported by take_measured_edge(); an extra one can
+ * be requested when something needs to be checked against the RTC.
+ */
+class TimeKeeper
+{
+	static constexpr uint32_t	kNominalSecondUs		{ 1000000 };
+	// Max allowed correction of local second length (±5%):
+	static constexpr uint32_t	kMaxTrimUs				{ 50000 };
+	// Start polling the RTC this long before the predicted second edge:
+	static constexpr uint32_t	kEdgeWindowUs			{ 50000 };
+	// Drift smaller than this lets the resync interval grow:
+	static constexpr int32_t	kLockedErrorUs			{ 2000 };
+	static constexpr uint16_t	kMinResyncIntervalS		{ 4 };
+	static constexpr uint16_t	kMaxResyncIntervalS		{ 256 };
+	// 2^31 / kNominalSecondUs:
+	static constexpr uint16_t	kNominalPhaseScale		{ fixed_point::reciprocal (kNominalSecondUs, 31) };
+
+	enum class State: uint8_t
+	{
+		// Polling RTC continuously until second edge is found:
+		Acquiring,
+		// Counting seconds locally:
+		Tracking,
+		// Polling RTC around predicted second edge:
+		WaitingForEdge,
+		// Reading full time right after the second edge:
+		Reading,
+	};
+
+	enum class PollResult: uint8_t
+	{
+		// Poll in progress or RTC still shows _rtc_seconds:
+		Pending,
+		// RTC seconds have changed right after a poll that has seen _rtc_seconds:
+		Edge,
+		// RTC seconds differ from _rtc_seconds, but the previous poll hasn't seen
+		// the old value, so time of the edge is unknown:
+		Missed,
+	};
+
+  public:
+	// Ctor
+	TimeKeeper (RTC&, RTCTransaction&);
+
+	/**
+	 * Read time from the RTC (blocking) and start looking for its second edge.
+	 * SystemClock must be initialized first.
+	 */
+	void
+	start();
+
+	/**
+	 * Advance local time and resynchronize with RTC when needed.
+	 * Call often, the more often, the more precise the synchronization.
+	 * Return true if time of day has changed.
+	 */
+	bool
+	update();
+
+	/**
+	 * Return current time of day.
+	 */
+	Time
+	now() const;
+
+	/**
+	 * Return predicted SystemClock::micros() time of the next second edge.
+	 */
+	uint32_t
+	next_edge_us() const;
+
+	/**
+	 * Measure the next RTC second edge even if resync isn't due yet.
+	 * Must be called well before the edge (more than kEdgeWindowUs).
+	 */
+	void
+	request_edge_measurement();
+
+	/**
+	 * Return time of RTC second edge measured since the last call.
+	 * Return false if none was.
+	 */
+	bool
+	take_measured_edge (uint32_t& edge_us);
+
+	/**
+	 * Return fraction of the current second that has elapsed,
+	 * 0 at the second edge, 0xffff at its end.
+	 */
+	uint16_t
+	phase() const;
+
+	/**
+	 * Blinker function - return true on odd subperiods of the current second.
+	 * Number of subperiods is determined by the modulo argument.
+	 * Subperiods start exactly at the second edge.
+	 */
+	bool
+	lit (uint8_t modulo) const;
+
+	/**
+	 * Blinker function for given phase().
+	 */
+	static bool
+	lit (uint16_t phase, uint8_t modulo);
+
+	/**
+	 * Set time in the RTC and locally.
+	 */
+	void
+	set_time (Time const&);
+
+	/**
+	 * Return last measured difference between RTC second edge and locally
+	 * predicted one. Positive means local clock runs too fast.
+	 */
+	int32_t
+	last_error_us() const;
+
+	/**
+	 * Return current interval between synchronizations.
+	 */
+	uint16_t
+	resync_interval() const;
+
+  private:
+	/**
+	 * Advance local time if local second has passed.
+	 * Return true if it did.
+	 */
+	bool
+	advance (uint32_t now_us);
+
+	/**
+	 * Set new length of the local second.
+	 */
+	void
+	set_second_length (uint32_t length_us);
+
+	/**
+	 * Switch to a state which polls the RTC for the second edge.
+	 * Result of any earlier transaction is dropped.
+	 */
+	void
+	start_polling (State);
+
+	/**
+	 * Check result of the last poll and start the next one, unless a poll is
+	 * in progress or the seconds value has changed.
+	 */
+	PollResult
+	poll_rtc_edge (uint32_t now_us);
+
+	/**
+	 * Called when RTC second edge has been detected at given time.
+	 */
+	void
+	synchronize (uint32_t edge_us, bool measure_drift);
+
+  private:
+	RTC&			_rtc;
+	RTCTransaction&	_transaction;
+	State			_state					{ State::Acquiring };
+	Time			_time;
+	// RTC seconds value seen before the edge:
+	uint8_t			_rtc_seconds			{ 0 };
+	// Start time of the current/last seconds poll:
+	uint32_t		_poll_start_us			{ 0 };
+	// The last poll in current state has seen _rtc_seconds:
+	bool			_old_second_seen		{ false };
+	uint32_t		_second_start_us		{ 0 };
+	uint32_t		_second_length_us		{ kNominalSecondUs };
+	// 2^31 / _second_length_us, used to compute phase without division:
+	uint16_t		_phase_scale			{ kNominalPhaseScale };
+	uint16_t		_seconds_since_sync		{ 0 };
+	uint16_t		_resync_interval		{ kMinResyncIntervalS };
+	int32_t			_last_error_us			{ 0 };
+	bool			_edge_requested			{ false };
+	bool			_edge_measured			{ false };
+	uint32_t		_measured_edge_us		{ 0 };
+};
+
+
+TimeKeeper::TimeKeeper (RTC& rtc, RTCTransaction& transaction):
+	_rtc (rtc),
+	_transaction (transaction)
+{ }
+
+
+void
+TimeKeeper::start()
+{
+	_transaction.abort();
+	_time = _rtc.get_time();
+	_rtc_seconds = _time.seconds;
+	_second_start_us = SystemClock::micros();
+	start_polling (State::Acquiring);
+}
+
+
+bool
+TimeKeeper::update()
+{
+	uint32_t const now_us = SystemClock::micros();
+	bool changed = false;
+
+	switch (_state)
+	{
+		case State::Acquiring:
+			changed = advance (now_us);
+
+			switch (poll_rtc_edge (now_us))
+			{
+				case PollResult::Pending:
+					break;
+
+				case PollResult::Edge:
+					synchronize (_poll_start_us, false);
+					changed = true;
+					break;
+
+				case PollResult::Missed:
+					// Wait for the next one:
+					_rtc_seconds = _transaction.seconds();
+					break;
+			}
+			break;
+
+		case State::Tracking:
+			changed = advance (now_us);
+
+			if ((_seconds_since_sync >= _resync_interval || _edge_requested) &&
+				now_us - _second_start_us >= _second_length_us - kEdgeWindowUs)
+			{
+				_rtc_seconds = _time.seconds;
+				start_polling (State::WaitingForEdge);
+			}
+			break;
+
+		case State::WaitingForEdge:
+		{
+			// Local second might pass before the RTC one:
+			bool const local_edge_passed = _time.seconds != _rtc_seconds;
+
+			changed = advance (now_us);
+
+			switch (poll_rtc_edge (now_us))
+			{
+				case PollResult::Pending:
+					if (local_edge_passed && now_us - _second_start_us > kEdgeWindowUs)
+					{
+						// RTC edge didn't come within the window, drift is too large:
+						_resync_interval = kMinResyncIntervalS;
+						start_polling (State::Acquiring);
+					}
+					break;
+
+				case PollResult::Edge:
+					// Edges measured on request are too close to each other to measure drift,
+					// but they still lock the phase:
+					synchronize (_poll_start_us, _seconds_since_sync >= _resync_interval);
+					changed = true;
+					break;
+
+				case PollResult::Missed:
+					// RTC has already ticked before polling started; search for the next edge:
+					_rtc_seconds = _transaction.seconds();
+					_resync_interval = kMinResyncIntervalS;
+					start_polling (State::Acquiring);
+					break;
+			}
+			break;
+		}
+
+		case State::Reading:
+			if (!_transaction.busy())
+			{
+				if (_transaction.succeeded())
+				{
+					_time = _transaction.last_good_time();
+					_state = State::Tracking;
+					changed = true;
+				}
+				else
+					_transaction.start_read_time();
+			}
+			break;
+	}
+
+	return changed;
+}
+
+
+inline Time
+TimeKeeper::now() const
+{
+	return _time;
+}
+
+
+uint16_t
+TimeKeeper::phase() const
+{
+	uint32_t const elapsed_us = SystemClock::micros() - _second_start_us;
+
+	// Local second might not have been advanced yet:
+	if (elapsed_us >= _second_length_us)
+		return 0xffff;
+
+	// Second length is at most ~1.05e6 µs and scale ~2260, so the product fits in 32 bits:
+	uint32_t const phase = (elapsed_us * _phase_scale) >> 15;
+
+	return phase > 0xffff ? 0xffff : phase;
+}
+
+
+inline bool
+TimeKeeper::lit (uint8_t modulo) const
+{
+	return lit (phase(), modulo);
+}
+
+
+inline bool
+TimeKeeper::lit (uint16_t phase, uint8_t modulo)
+{
+	return ((static_cast<uint32_t> (phase) * modulo) >> 16) % 2 == 0;
+}
+
+
+void
+TimeKeeper::set_time (Time const& time)
+{
+	_transaction.abort();
+	_rtc.set_time (time);
+	// Writing seconds restarts RTC second countdown, so its next edge
+	// will come about a second from now:
+	start();
+}
+
+
+inline uint32_t
+TimeKeeper::next_edge_us() const
+{
+	return _second_start_us + _second_length_us;
+}
+
+
+inline void
+TimeKeeper::request_edge_measurement()
+{
+	_edge_requested = true;
+}
+
+
+inline bool
+TimeKeeper::take_measured_edge (uint32_t& edge_us)
+{
+	if (!_edge_measured)
+		return false;
+
+	edge_us = _measured_edge_us;
+	_edge_measured = false;
+	return true;
+}
+
+
+inline int32_t
+TimeKeeper::last_error_us() const
+{
+	return _last_error_us;
+}
+
+
+inline uint16_t
+TimeKeeper::resync_interval() const
+{
+	return _resync_interval;
+}
+
+
+inline bool
+TimeKeeper::advance (uint32_t now_us)
+{
+	if (now_us - _second_start_us < _second_length_us)
+		return false;
+
+	_second_start_us += _second_length_us;
+	_time.increment_seconds();
+
+	if (_seconds_since_sync < 0xffff)
+		_seconds_since_sync++;
+
+	return true;
+}
+
+
+inline void
+TimeKeeper::set_second_length (uint32_t length_us)
+{
+	_second_length_us = length_us;
+
+	// Length differs from nominal by at most ±5%, so 1 / (1 + δ) ≈ 1 - δ + δ²
+	// is exact to within δ³ ≈ 1.25e-4:
+	int32_t const delta_q16 = fixed_point::divide<kNominalSecondUs, kMaxTrimUs, 16> (static_cast<int32_t> (length_us - kNominalSecondUs));
+	uint32_t const factor_q16 = (1L << 16) - delta_q16 + ((delta_q16 * delta_q16) >> 16);
+
+	_phase_scale = (kNominalPhaseScale * factor_q16) >> 16;
+}
+
+
+inline void
+TimeKeeper::start_polling (State state)
+{
+	_transaction.abort();
+	_old_second_seen = false;
+	_state = state;
+}
+
+
+auto
+TimeKeeper::poll_rtc_edge (uint32_t now_us) -> PollResult
+{
+	if (_transaction.busy())
+		return PollResult::Pending;
+
+	// Only polls started in current state can succeed here, see start_polling():
+	if (_transaction.succeeded())
+	{
+		if (_transaction.seconds() != _rtc_seconds)
+			return _old_second_seen ? PollResult::Edge : PollResult::Missed;
+
+		_old_second_seen = true;
+	}
+	else
+		_old_second_seen = false;
+
+	_poll_start_us = now_us;
+	_transaction.start_read_seconds();
+
+	return PollResult::Pending;
+}
+
+
+void
+TimeKeeper::synchronize (uint32_t edge_us, bool measure_drift)
+{
+	if (measure_drift && _seconds_since_sync > 0)
+	{
+		// Predicted edge is either the local edge that just passed, or the next one:
+		uint32_t const predicted_edge_us = _time.seconds != _rtc_seconds
+			? _second_start_us
+			: _second_start_us + _second_length_us;
+		uint16_t const seconds = _time.seconds != _rtc_seconds
+			? _seconds_since_sync
+			: _seconds_since_sync + 1;
+
+		_last_error_us = static_cast<int32_t> (edge_us - predicted_edge_us);
+
+		// Resyncs happen every 2^n seconds (or one second later), so dividing by
+		// the nearest lower power of two is close enough and needs no division:
+		int32_t const trim_us = fixed_point::shift_right_rounded (_last_error_us, fixed_point::log2 (seconds));
+		int32_t const new_length_us = static_cast<int32_t> (_second_length_us) + trim_us;
+		int32_t const min_length_us = kNominalSecondUs - kMaxTrimUs;
+		int32_t const max_length_us = kNominalSecondUs + kMaxTrimUs;
+
+		set_second_length (new_length_us < min_length_us ? min_length_us
+						   : new_length_us > max_length_us ? max_length_us
+						   : new_length_us);
+
+		if (-kLockedErrorUs < _last_error_us && _last_error_us < kLockedErrorUs)
+		{
+			if (_resync_interval < kMaxResyncIntervalS)
+				_resync_interval *= 2;
+		}
+		else
+			_resync_interval = kMinResyncIntervalS;
+	}
+
+	// Show the new second right away, full time will be read in a moment:
+	if (_time.seconds == _rtc_seconds)
+		_time.increment_seconds();
+
+	_rtc_seconds = _transaction.seconds();
+	_second_start_us = edge_us;
+	_seconds_since_sync = 0;
+	_edge_requested = false;
+	_edge_measured = true;
+	_measured_edge_us = edge_us;
+	// Right after the edge the RTC registers won't change for almost a second:
+	_transaction.start_read_time();
+	_state = State::Reading;
+}
+
+#endif
+
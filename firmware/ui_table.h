@@ -0,0 +1,171 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2014  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef CLOCK_1337__UI_TABLE__INCLUDED
+#define CLOCK_1337__UI_TABLE__INCLUDED
+
+// System:
+#include <avr/pgmspace.h>
+
+
+/**
+ * Button UI state machine used by Clock. Kept apart from Clock so that
+ * host/ui_table_tool can check and print it without the rest of the firmware.
+ */
+namespace ui {
+
+/**
+ * UI state, combination of ClockMode and SetupDigit (see Clock::ui_state()).
+ */
+enum class State: uint8_t
+{
+	Clock,
+	BeepSetup,
+	SetupHours10,
+	SetupHours1,
+	SetupMinutes10,
+	SetupMinutes1,
+};
+
+constexpr uint8_t	kStatesCount	{ 6 };
+
+/**
+ * Button events. Levels are press lengths in kButtonThresholdMs units
+ * (see GestureRecognizer); level 4 stands for 4 and more.
+ */
+enum class Event: uint8_t
+{
+	Click,
+	Hold2,
+	Hold3,
+	Hold4,
+	Release2,
+	Release3,
+	Release4,
+	Up,
+	Down,
+};
+
+constexpr uint8_t	kEventsCount	{ 9 };
+
+enum class Action: uint8_t
+{
+	None,
+	ShowModeOverride,
+	ShowBeepOverride,
+	ShowSetOverride,
+	TogglePrecision,
+	ToggleDisplayMode,
+	EnterBeepSetup,
+	ToggleBeeper,
+	EnterTimeSetup,
+	DigitUp,
+	DigitDown,
+	NextDigit,
+	CommitTime,
+};
+
+struct Transition
+{
+	Action		action;
+	State		next;
+	// Ignore the rest of the current press:
+	bool		ignore_press;
+};
+
+/**
+ * UI transitions, indexed by [State][Event]. Release events also clear
+ * the display override. Run host/ui_table_tool to check the graph and
+ * see it drawn (ui_table_tool dot | dot -Tsvg).
+ */
+constexpr Transition kTable[kStatesCount][kEventsCount] PROGMEM = {
+	// Clock:
+	{
+		{ Action::TogglePrecision,		State::Clock,			false },	// Click
+		{ Action::ShowModeOverride,		State::Clock,			false },	// Hold2
+		{ Action::ShowBeepOverride,		State::Clock,			false },	// Hold3
+		{ Action::ShowSetOverride,		State::Clock,			false },	// Hold4
+		{ Action::ToggleDisplayMode,	State::Clock,			false },	// Release2
+		{ Action::EnterBeepSetup,		State::BeepSetup,		false },	// Release3
+		{ Action::EnterTimeSetup,		State::SetupHours10,	false },	// Release4
+		{ Action::None,					State::Clock,			false },	// Up
+		{ Action::None,					State::Clock,			false },	// Down
+	},
+	// BeepSetup:
+	{
+		{ Action::ToggleBeeper,			State::BeepSetup,		false },	// Click
+		{ Action::None,					State::Clock,			true },		// Hold2
+		{ Action::None,					State::Clock,			true },		// Hold3
+		{ Action::None,					State::Clock,			true },		// Hold4
+		{ Action::None,					State::BeepSetup,		false },	// Release2
+		{ Action::None,					State::BeepSetup,		false },	// Release3
+		{ Action::None,					State::BeepSetup,		false },	// Release4
+		{ Action::None,					State::BeepSetup,		false },	// Up
+		{ Action::None,					State::BeepSetup,		false },	// Down
+	},
+	// SetupHours10:
+	{
+		{ Action::DigitUp,				State::SetupHours10,	false },	// Click
+		{ Action::NextDigit,			State::SetupHours1,		true },		// Hold2
+		{ Action::NextDigit,			State::SetupHours1,		true },		// Hold3
+		{ Action::NextDigit,			State::SetupHours1,		true },		// Hold4
+		{ Action::None,					State::SetupHours10,	false },	// Release2
+		{ Action::None,					State::SetupHours10,	false },	// Release3
+		{ Action::None,					State::SetupHours10,	false },	// Release4
+		{ Action::DigitUp,				State::SetupHours10,	false },	// Up
+		{ Action::DigitDown,			State::SetupHours10,	false },	// Down
+	},
+	// SetupHours1:
+	{
+		{ Action::DigitUp,				State::SetupHours1,		false },	// Click
+		{ Action::NextDigit,			State::SetupMinutes10,	true },		// Hold2
+		{ Action::NextDigit,			State::SetupMinutes10,	true },		// Hold3
+		{ Action::NextDigit,			State::SetupMinutes10,	true },		// Hold4
+		{ Action::None,					State::SetupHours1,		false },	// Release2
+		{ Action::None,					State::SetupHours1,		false },	// Release3
+		{ Action::None,					State::SetupHours1,		false },	// Release4
+		{ Action::DigitUp,				State::SetupHours1,		false },	// Up
+		{ Action::DigitDown,			State::SetupHours1,		false },	// Down
+	},
+	// SetupMinutes10:
+	{
+		{ Action::DigitUp,				State::SetupMinutes10,	false },	// Click
+		{ Action::NextDigit,			State::SetupMinutes1,	true },		// Hold2
+		{ Action::NextDigit,			State::SetupMinutes1,	true },		// Hold3
+		{ Action::NextDigit,			State::SetupMinutes1,	true },		// Hold4
+		{ Action::None,					State::SetupMinutes10,	false },	// Release2
+		{ Action::None,					State::SetupMinutes10,	false },	// Release3
+		{ Action::None,					State::SetupMinutes10,	false },	// Release4
+		{ Action::DigitUp,				State::SetupMinutes10,	false },	// Up
+		{ Action::DigitDown,			State::SetupMinutes10,	false },	// Down
+	},
+	// SetupMinutes1:
+	{
+		{ Action::DigitUp,				State::SetupMinutes1,	false },	// Click
+		{ Action::None,					State::SetupMinutes1,	false },	// Hold2
+		{ Action::None,					State::SetupMinutes1,	false },	// Hold3
+		{ Action::None,					State::SetupMinutes1,	false },	// Hold4
+		{ Action::CommitTime,			State::Clock,			false },	// Release2
+		{ Action::CommitTime,			State::Clock,			false },	// Release3
+		{ Action::CommitTime,			State::Clock,			false },	// Release4
+		{ Action::DigitUp,				State::SetupMinutes1,	false },	// Up
+		{ Action::DigitDown,			State::SetupMinutes1,	false },	// Down
+	},
+};
+
+static_assert (sizeof (kTable) == kStatesCount * kEventsCount * sizeof (Transition), "UI table is incomplete");
+
+} // namespace ui
+
+#endif
+